@@ -5,7 +5,8 @@
 #include "../../framework_core/common.h"
 #include "../../framework_core/vec2.h"
 
-struct dust_t : public tengu::object_ex_t<e_object_particles, dust_t> {
+struct dust_t : public tengu::object_ex_t<e_object_particles, dust_t,
+                                           tengu::object_pool_t<dust_t> > {
     static const uint32_t _ORDER = e_object_particles;
 
     typedef tengu::vec2f_t vec2f_t;
@@ -1,8 +1,10 @@
 #include "../framework_core/common.h"
+#include "../framework_core/profile.h"
 #include "audio.h"
 
 namespace tengu {
 bool audio_t::render(int16_t * out, uint32_t count) {
+    TENGU_PROFILE_ZONE("audio.render");
     while (count) {
         // figure our how many samples to render
         const uint32_t samples = minv(count, C_BUFFER_SIZE);
@@ -2,7 +2,7 @@
 #include <memory>
 #include <cstdint>
 
-#include "queue.h"
+#include "../framework_core/spsc.h"
 #include "format/wave.h"
 #include "format/vorbis.h"
 
@@ -1,6 +1,7 @@
 #include <cassert>
 
 #include "../../format/vorbis.h"
+#include "../../../framework_core/profile.h"
 #include "source_vorbis.h"
 #include "stb_vorbis.h"
 
@@ -108,6 +109,7 @@ void audio_source_vorbis_t::_clear_buffer()
 void audio_source_vorbis_t::render(
     const mix_out_t& mix)
 {
+    TENGU_PROFILE_ZONE("audio.vorbis");
     if (!stb_ || finished_) {
         _enqueue();
     }
@@ -21,8 +21,8 @@ struct audio_source_vorbis_t : public audio_source_t {
 
     bool play(const play_vorbis_t& info)
     {
-        queue_.push(info);
-        return true;
+        // fails if the audio thread has fallen this far behind
+        return queue_.push(info);
     }
 
     virtual void render(
@@ -35,6 +35,7 @@ protected:
     void _render(const mix_out_t& mix);
 
     static const size_t C_CHANNELS = 2;
+    static const size_t C_QUEUE_SIZE = 16;
     std::array<int16_t, 4096 * C_CHANNELS> buffer_;
     size_t head_;
     size_t tail_;
@@ -43,6 +44,7 @@ protected:
     struct ::stb_vorbis* stb_;
     int32_t volume_;
 
-    queue_t<play_vorbis_t> queue_;
+    // commands from the game thread, read by the audio callback
+    spsc_ring_t<play_vorbis_t, C_QUEUE_SIZE> queue_;
 };
 } // namespace tengu
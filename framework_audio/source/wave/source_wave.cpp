@@ -1,3 +1,4 @@
+#include "../../../framework_core/profile.h"
 #include "source_wave.h"
 
 namespace tengu {
@@ -193,6 +194,7 @@ void audio_source_wave_t::_check_messages()
 void audio_source_wave_t::render(
     const mix_out_t& mix)
 {
+    TENGU_PROFILE_ZONE("audio.wave");
 
     // check pending messages
     _check_messages();
@@ -18,11 +18,13 @@ struct audio_source_wave_t : public audio_source_t {
 
     bool play(const play_wave_t& info)
     {
-        queue_.push(info);
-        return true;
+        // fails if the audio thread has fallen this far behind
+        return queue_.push(info);
     }
 
 protected:
+    static const size_t C_QUEUE_SIZE = 64;
+
     struct info_wave_t {
         const wave_t* wave_;
         uint64_t frame_; // 0xffff fixed point
@@ -51,6 +53,7 @@ protected:
         info_wave_t& info);
 
     std::map<const wave_t*, info_wave_t> waves_;
-    queue_t<play_wave_t> queue_;
+    // commands from the game thread, read by the audio callback
+    spsc_ring_t<play_wave_t, C_QUEUE_SIZE> queue_;
 };
 } // namespace tengu
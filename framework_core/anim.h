@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <queue>
@@ -366,5 +367,500 @@ protected:
     std::queue<uint32_t> event_;
 };
 
+// controllers for many sprites at once.  sequences are compiled into flat
+// tables of keys, one per frame or delay, each with the time it starts at
+// within a pass of the sequence, so a controller finds where it should be
+// after any amount of time with a binary search rather than stepping
+// opcodes.  controller state is held in parallel arrays indexed by
+// controller id and tick() advances them all in a single pass, most of
+// which is an add and a compare against the time of the next key.
+// programs behave as controller_t would run the same sequence, except a
+// skipped rand_frame is never rolled.
+struct system_t {
+
+    enum : uint32_t {
+        c_none = 0xffffffffu,
+        // sequences which can be pushed onto one controller
+        c_max_depth = 4,
+    };
+
+    // an op_event raised by a controller during tick()
+    struct fired_t {
+        uint32_t controller_;
+        int32_t event_;
+    };
+
+    system_t()
+        : prng_(0xcafebabe)
+    {
+    }
+
+    // compile a sequence for controllers to play, returns its program id.
+    // the sequence is copied so may be changed or freed afterwards.
+    uint32_t compile(const sequence_t& seq)
+    {
+        struct visit_t {
+            int32_t pc_;
+            int32_t interval_;
+            int32_t frame_lo_, frame_hi_;
+            pose_t pose_;
+            uint32_t key_;
+            uint32_t event_;
+            int64_t time_;
+
+            bool same(const visit_t& o) const
+            {
+                return pc_ == o.pc_ && interval_ == o.interval_ &&
+                    frame_lo_ == o.frame_lo_ &&
+                    frame_hi_ == o.frame_hi_ && pose_ == o.pose_;
+            }
+        };
+        program_t prog;
+        prog.key_ = uint32_t(start_.size());
+        prog.event_ = uint32_t(event_.size());
+        prog.loop_key_ = c_none;
+        prog.loop_event_ = 0;
+        prog.loop_start_ = 0;
+        prog.end_type_ = seq.end_type_;
+        // run the opcodes once over, laying down a key for each one which
+        // takes time, until the sequence ends or comes back around to a
+        // point it has already been at in the same state.  sequences are
+        // short so the points visited are simply searched.
+        std::vector<visit_t> visit;
+        visit_t state = { 0, 1, -1, -1, pose_t{ 0, 0, 0, 0 }, 0, 0, 0 };
+        int32_t src = -1;
+        int32_t pc = 0;
+        for (;;) {
+            if (pc >= seq.size()) {
+                if (seq.end_type_ != sequence_t::e_end_loop || !seq.size()) {
+                    break;
+                }
+                pc = 0;
+            }
+            state.pc_ = pc;
+            state.key_ = uint32_t(start_.size()) - prog.key_;
+            state.event_ = uint32_t(event_.size()) - prog.event_;
+            auto v = std::find_if(visit.begin(), visit.end(),
+                [&state](const visit_t& v) { return v.same(state); });
+            if (v != visit.end()) {
+                prog.loop_key_ = v->key_;
+                prog.loop_event_ = v->event_;
+                prog.loop_start_ = v->time_;
+                break;
+            }
+            visit.push_back(state);
+            const sequence_t::opcode_t& op = seq.get_opcode(pc);
+            switch (op.type_) {
+            case (sequence_t::e_op_interval):
+                assert(op.x_ >= 0);
+                state.interval_ = std::max(op.x_, 0);
+                break;
+            case (sequence_t::e_op_frame):
+            case (sequence_t::e_op_rand_frame):
+                src = int32_t(start_.size() - prog.key_);
+                state.frame_lo_ = op.x_;
+                state.frame_hi_ = (op.type_ == sequence_t::e_op_frame) ? op.x_ : op.y_;
+                add_key(prog, src, state);
+                state.time_ += state.interval_;
+                break;
+            case (sequence_t::e_op_delay):
+                assert(op.x_ >= 0);
+                add_key(prog, src, state);
+                state.time_ += std::max(op.x_, 0);
+                break;
+            case (sequence_t::e_op_event):
+                event_.push_back(op.x_);
+                break;
+            case (sequence_t::e_op_jmp):
+                assert(op.x_ >= 0 && op.x_ < seq.size());
+                pc = op.x_;
+                continue;
+            case (sequence_t::e_op_hotspot):
+                state.pose_.hotspot_x_ = op.x_;
+                state.pose_.hotspot_y_ = op.y_;
+                break;
+            case (sequence_t::e_op_offset):
+                state.pose_.offset_x_ = op.x_;
+                state.pose_.offset_y_ = op.y_;
+                break;
+            default:
+                assert(!"unknown opcode");
+            }
+            ++pc;
+        }
+        prog.keys_ = uint32_t(start_.size()) - prog.key_;
+        prog.events_ = uint32_t(event_.size()) - prog.event_;
+        prog.duration_ = state.time_;
+        prog.end_ = state.pose_;
+        // a loop which takes no time would spin forever, so hold instead
+        if (prog.loop_key_ != c_none && prog.duration_ == prog.loop_start_) {
+            prog.loop_key_ = c_none;
+            prog.end_type_ = sequence_t::e_end_hold;
+        }
+        program_.push_back(prog);
+        return uint32_t(program_.size() - 1);
+    }
+
+    // make a controller drawing frames from 'sheet', returns its id
+    uint32_t create(const sheet_t* sheet)
+    {
+        uint32_t id;
+        if (free_.empty()) {
+            id = uint32_t(prog_.size());
+            prog_.push_back(c_none);
+            time_.push_back(0);
+            next_.push_back(0);
+            key_.push_back(-1);
+            cursor_.push_back(0);
+            frame_.push_back(-1);
+            pose_.push_back(pose_t{ 0, 0, 0, 0 });
+            sheet_.push_back(sheet);
+            depth_.push_back(0);
+            stack_.resize(stack_.size() + c_max_depth - 1);
+        } else {
+            id = free_.back();
+            free_.pop_back();
+            sheet_[id] = sheet;
+        }
+        return id;
+    }
+
+    void destroy(uint32_t id)
+    {
+        assert(id < prog_.size());
+        prog_[id] = c_none;
+        depth_[id] = 0;
+        free_.push_back(id);
+    }
+
+    // play 'program' over the current sequence.  returns false, leaving
+    // the stack as it was, if c_max_depth sequences are already pushed.
+    bool push_sequence(uint32_t id, uint32_t program)
+    {
+        assert(id < prog_.size() && program < program_.size());
+        if (depth_[id] >= c_max_depth) {
+            return false;
+        }
+        if (depth_[id]) {
+            stack_[id * (c_max_depth - 1) + depth_[id] - 1] = save(id);
+        }
+        ++depth_[id];
+        prog_[id] = program;
+        time_[id] = 0;
+        key_[id] = -1;
+        cursor_[id] = 0;
+        frame_[id] = -1;
+        pose_[id] = pose_t{ 0, 0, 0, 0 };
+        const program_t& p = program_[program];
+        next_[id] = p.keys_ ? start_[p.key_] : p.duration_;
+        return true;
+    }
+
+    void set_sequence(uint32_t id, uint32_t program)
+    {
+        pop_sequence(id);
+        push_sequence(id, program);
+    }
+
+    void pop_sequence(uint32_t id)
+    {
+        assert(id < prog_.size());
+        if (depth_[id] == 0) {
+            return;
+        }
+        if (--depth_[id]) {
+            load(id, stack_[id * (c_max_depth - 1) + depth_[id] - 1]);
+        } else {
+            prog_[id] = c_none;
+        }
+    }
+
+    // start the current sequence over once the frame showing has run out
+    bool retrigger(uint32_t id)
+    {
+        assert(id < prog_.size());
+        if (prog_[id] == c_none) {
+            return false;
+        }
+        const program_t& p = program_[prog_[id]];
+        const bool held = next_[id] == c_forever;
+        time_[id] = held ? 0 : time_[id] - next_[id];
+        key_[id] = -1;
+        cursor_[id] = 0;
+        next_[id] = p.keys_ ? start_[p.key_] : p.duration_;
+        return true;
+    }
+
+    // advance every controller by 'delta'
+    void tick(int32_t delta)
+    {
+        fired_.clear();
+        const uint32_t count = uint32_t(prog_.size());
+        for (uint32_t i = 0; i < count; ++i) {
+            if (prog_[i] == c_none) {
+                continue;
+            }
+            const int64_t time = time_[i] + delta;
+            time_[i] = time;
+            if (time > next_[i]) {
+                advance(i);
+            }
+        }
+    }
+
+    // events raised by the last tick(), in controller order
+    const std::vector<fired_t>& events() const
+    {
+        return fired_;
+    }
+
+    bool get_sequence(uint32_t id, uint32_t& out) const
+    {
+        assert(id < prog_.size());
+        out = prog_[id];
+        return out != c_none;
+    }
+
+    bool get_frame(uint32_t id, recti_t& out) const
+    {
+        assert(id < prog_.size());
+        if (prog_[id] == c_none) {
+            return false;
+        }
+        if (frame_[id] < 0) {
+            out = recti_t{ 0, 0, 0, 0 };
+        } else {
+            assert(sheet_[id]);
+            out = sheet_[id]->get_frame(frame_[id]);
+        }
+        return true;
+    }
+
+    bool get_hotspot(uint32_t id, int32_t& x_out, int32_t& y_out) const
+    {
+        assert(id < prog_.size());
+        x_out = pose_[id].hotspot_x_;
+        y_out = pose_[id].hotspot_y_;
+        return prog_[id] != c_none;
+    }
+
+    bool get_offset(uint32_t id, int32_t& x_out, int32_t& y_out) const
+    {
+        assert(id < prog_.size());
+        x_out = pose_[id].offset_x_;
+        y_out = pose_[id].offset_y_;
+        return prog_[id] != c_none;
+    }
+
+    bool is_playing(uint32_t id, uint32_t program) const
+    {
+        assert(id < prog_.size());
+        return prog_[id] != c_none && prog_[id] == program;
+    }
+
+    // number of controller ids handed out, live or free
+    size_t size() const
+    {
+        return prog_.size();
+    }
+
+protected:
+    enum : int64_t {
+        // next_ of a controller holding its last frame
+        c_forever = INT64_MAX,
+    };
+
+    struct pose_t {
+        int32_t hotspot_x_, hotspot_y_;
+        int32_t offset_x_, offset_y_;
+
+        bool operator==(const pose_t& o) const
+        {
+            return hotspot_x_ == o.hotspot_x_ && hotspot_y_ == o.hotspot_y_ &&
+                offset_x_ == o.offset_x_ && offset_y_ == o.offset_y_;
+        }
+    };
+
+    // a frame or delay within a compiled sequence.  its start time is kept
+    // apart in start_ so searches only touch the times.
+    struct key_t {
+        // events which come before this key, relative to the program
+        uint32_t event_;
+        // key which chose the frame being shown, -1 for none yet
+        int32_t src_;
+        // frame, or the range of a rand_frame
+        int32_t frame_lo_, frame_hi_;
+        pose_t pose_;
+    };
+
+    struct program_t {
+        uint32_t key_, keys_;
+        uint32_t event_, events_;
+        // a pass ends at duration_, then loops back to loop_key_ which
+        // starts at loop_start_, with loop_event_ events already raised
+        int64_t duration_;
+        int64_t loop_start_;
+        uint32_t loop_key_;
+        uint32_t loop_event_;
+        sequence_t::end_type_t end_type_;
+        // pose after the last opcode
+        pose_t end_;
+    };
+
+    // a sequence pushed under the current one
+    struct state_t {
+        uint32_t prog_;
+        int64_t time_, next_;
+        int32_t key_;
+        uint32_t cursor_;
+        int32_t frame_;
+        pose_t pose_;
+    };
+
+    template <typename visit_t>
+    void add_key(const program_t& prog, int32_t src, const visit_t& state)
+    {
+        start_.push_back(state.time_);
+        key_t k;
+        k.event_ = uint32_t(event_.size()) - prog.event_;
+        k.src_ = src;
+        k.frame_lo_ = state.frame_lo_;
+        k.frame_hi_ = state.frame_hi_;
+        k.pose_ = state.pose_;
+        keys_.push_back(k);
+    }
+
+    state_t save(uint32_t id) const
+    {
+        return state_t{ prog_[id], time_[id], next_[id], key_[id],
+            cursor_[id], frame_[id], pose_[id] };
+    }
+
+    void load(uint32_t id, const state_t& s)
+    {
+        prog_[id] = s.prog_;
+        time_[id] = s.time_;
+        next_[id] = s.next_;
+        key_[id] = s.key_;
+        cursor_[id] = s.cursor_;
+        frame_[id] = s.frame_;
+        pose_[id] = s.pose_;
+    }
+
+    // raise the events in [from, to) of a program
+    void fire(uint32_t id, const program_t& p, uint32_t from, uint32_t to)
+    {
+        for (uint32_t i = from; i < to; ++i) {
+            fired_.push_back(fired_t{ id, event_[p.event_ + i] });
+        }
+    }
+
+    // move from key 'from' to a later key 'to', raising the events
+    // between and taking on the pose of 'to'
+    void enter(uint32_t id, const program_t& p, int32_t from, int32_t to,
+        uint32_t cursor)
+    {
+        const key_t& k = keys_[p.key_ + to];
+        fire(id, p, cursor, k.event_);
+        pose_[id] = k.pose_;
+        // only pick a frame if it was chosen by a key just passed
+        if (k.src_ > from) {
+            frame_[id] = (k.frame_lo_ == k.frame_hi_)
+                ? k.frame_lo_
+                : prng_.rand_range(k.frame_lo_, k.frame_hi_);
+        } else if (k.src_ < 0) {
+            frame_[id] = -1;
+        }
+    }
+
+    // slow path of tick(), the controller has passed the start of its
+    // next key or the end of its sequence
+    void advance(uint32_t id)
+    {
+        const program_t& p = program_[prog_[id]];
+        const int64_t* start = start_.data() + p.key_;
+        const key_t* keys = keys_.data() + p.key_;
+        int64_t time = time_[id];
+        int32_t key = key_[id];
+        uint32_t cursor = cursor_[id];
+        if (time > p.duration_) {
+            // pass every key left so the last frame is the one showing
+            if (key + 1 < int32_t(p.keys_)) {
+                enter(id, p, key, int32_t(p.keys_) - 1, cursor);
+                key = int32_t(p.keys_) - 1;
+                cursor = keys[key].event_;
+            }
+            fire(id, p, cursor, p.events_);
+            pose_[id] = p.end_;
+            if (p.loop_key_ == c_none) {
+                if (p.end_type_ == sequence_t::e_end_pop) {
+                    // time left over is dropped as controller_t does
+                    pop_sequence(id);
+                    return;
+                }
+                key_[id] = int32_t(p.keys_) - 1;
+                cursor_[id] = p.events_;
+                next_[id] = c_forever;
+                return;
+            }
+            // wrap around, raising the events of any whole passes skipped
+            const int64_t period = p.duration_ - p.loop_start_;
+            time = p.loop_start_ + (time - p.duration_);
+            if (time > p.duration_) {
+                const int64_t passes = (time - p.duration_ + period - 1) / period;
+                if (p.events_ > p.loop_event_) {
+                    for (int64_t i = 0; i < passes; ++i) {
+                        fire(id, p, p.loop_event_, p.events_);
+                    }
+                }
+                time -= passes * period;
+            }
+            key = int32_t(p.loop_key_) - 1;
+            cursor = p.loop_event_;
+        }
+        // last key starting before now
+        const int32_t next = int32_t(std::lower_bound(
+            start + key + 1, start + p.keys_, time) - start);
+        const int32_t last = next - 1;
+        if (last > key) {
+            enter(id, p, key, last, cursor);
+            cursor = keys[last].event_;
+            key = last;
+        }
+        time_[id] = time;
+        key_[id] = key;
+        cursor_[id] = cursor;
+        next_[id] = (next < int32_t(p.keys_)) ? start[next] : p.duration_;
+    }
+
+    random_t prng_;
+
+    // compiled programs and their flat key and event tables
+    std::vector<program_t> program_;
+    std::vector<int64_t> start_;
+    std::vector<key_t> keys_;
+    std::vector<int32_t> event_;
+
+    // per controller state, indexed by controller id
+    std::vector<uint32_t> prog_;
+    // time into the current pass, and the time of the next change
+    std::vector<int64_t> time_;
+    std::vector<int64_t> next_;
+    // last key passed, -1 before the first
+    std::vector<int32_t> key_;
+    // events raised so far this pass
+    std::vector<uint32_t> cursor_;
+    std::vector<int32_t> frame_;
+    std::vector<pose_t> pose_;
+    std::vector<const sheet_t*> sheet_;
+    std::vector<uint8_t> depth_;
+    // sequences pushed under the current one, c_max_depth - 1 per id
+    std::vector<state_t> stack_;
+    std::vector<uint32_t> free_;
+
+    // events raised by the last tick()
+    std::vector<fired_t> fired_;
+};
+
 } // namespace anim
 } // namespace tengu
\ No newline at end of file
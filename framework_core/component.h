@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "objects.h"
+
+namespace tengu {
+
+// dense storage for a single component type keyed by object handle.
+// components live in one contiguous array with a parallel array of their
+// owning handles, so systems can walk them as plain loops rather than
+// visiting objects one at a time through object_t::tick().
+template <typename type_t>
+struct component_store_t {
+
+    enum : uint32_t {
+        c_none = 0xffffffffu
+    };
+
+    // add a component for handle h, or return the existing one
+    type_t& add(object_handle_t h, const type_t& value = type_t())
+    {
+        assert(h.valid());
+        const uint32_t index = h.index();
+        if (index >= sparse_.size()) {
+            sparse_.resize(index + 1, c_none);
+        }
+        uint32_t& slot = sparse_[index];
+        if (slot != c_none) {
+            if (handle_[slot] == h) {
+                return data_[slot];
+            }
+            // slot belongs to a stale handle, recycle it
+            data_[slot] = value;
+            handle_[slot] = h;
+            return data_[slot];
+        }
+        slot = uint32_t(data_.size());
+        data_.push_back(value);
+        handle_.push_back(h);
+        return data_.back();
+    }
+
+    // remove the component for h by swapping the last entry into its place
+    bool remove(object_handle_t h)
+    {
+        const uint32_t slot = find(h);
+        if (slot == c_none) {
+            return false;
+        }
+        const uint32_t last = uint32_t(data_.size() - 1);
+        if (slot != last) {
+            data_[slot] = data_[last];
+            handle_[slot] = handle_[last];
+            sparse_[handle_[slot].index()] = slot;
+        }
+        sparse_[h.index()] = c_none;
+        data_.pop_back();
+        handle_.pop_back();
+        return true;
+    }
+
+    type_t* get(object_handle_t h)
+    {
+        const uint32_t slot = find(h);
+        return (slot == c_none) ? nullptr : &data_[slot];
+    }
+
+    const type_t* get(object_handle_t h) const
+    {
+        const uint32_t slot = find(h);
+        return (slot == c_none) ? nullptr : &data_[slot];
+    }
+
+    bool has(object_handle_t h) const
+    {
+        return find(h) != c_none;
+    }
+
+    // dense index of h or c_none
+    uint32_t find(object_handle_t h) const
+    {
+        const uint32_t index = h.index();
+        if (index >= sparse_.size()) {
+            return c_none;
+        }
+        const uint32_t slot = sparse_[index];
+        if (slot == c_none || handle_[slot] != h) {
+            return c_none;
+        }
+        return slot;
+    }
+
+    // drop components whose objects have been destroyed
+    template <typename factory_t>
+    void prune(const factory_t& factory)
+    {
+        for (size_t i = 0; i < handle_.size();) {
+            if (factory.resolve(handle_[i])) {
+                ++i;
+            } else {
+                remove(handle_[i]);
+            }
+        }
+    }
+
+    // reorder so that entries shared with lead sit at the same dense
+    // index as in lead.  stores aligned this way can be walked in
+    // lockstep without touching the sparse index.
+    template <typename other_t>
+    void align(const component_store_t<other_t>& lead)
+    {
+        const object_handle_t* order = lead.handles();
+        uint32_t next = 0;
+        for (size_t i = 0; i < lead.size(); ++i) {
+            const uint32_t slot = find(order[i]);
+            if (slot == c_none) {
+                continue;
+            }
+            swap_slots(slot, next++);
+        }
+    }
+
+    void clear()
+    {
+        sparse_.clear();
+        data_.clear();
+        handle_.clear();
+    }
+
+    size_t size() const
+    {
+        return data_.size();
+    }
+
+    bool empty() const
+    {
+        return data_.empty();
+    }
+
+    type_t* data()
+    {
+        return data_.data();
+    }
+
+    const type_t* data() const
+    {
+        return data_.data();
+    }
+
+    const object_handle_t* handles() const
+    {
+        return handle_.data();
+    }
+
+protected:
+    void swap_slots(uint32_t a, uint32_t b)
+    {
+        if (a == b) {
+            return;
+        }
+        std::swap(data_[a], data_[b]);
+        std::swap(handle_[a], handle_[b]);
+        sparse_[handle_[a].index()] = a;
+        sparse_[handle_[b].index()] = b;
+    }
+
+    // handle index -> dense slot
+    std::vector<uint32_t> sparse_;
+    // dense component data and owning handles
+    std::vector<type_t> data_;
+    std::vector<object_handle_t> handle_;
+};
+
+namespace component {
+inline bool has_all(object_handle_t)
+{
+    return true;
+}
+
+template <typename type_t, typename... rest_t>
+bool has_all(object_handle_t h,
+    const component_store_t<type_t>& store,
+    const component_store_t<rest_t>&... rest)
+{
+    return store.has(h) && has_all(h, rest...);
+}
+
+inline bool aligned(size_t, object_handle_t)
+{
+    return true;
+}
+
+template <typename type_t, typename... rest_t>
+bool aligned(size_t i, object_handle_t h,
+    const component_store_t<type_t>& store,
+    const component_store_t<rest_t>&... rest)
+{
+    return i < store.size() && store.handles()[i] == h && aligned(i, h, rest...);
+}
+} // namespace component
+
+// call func(handle, first&, rest&...) for every handle which has all of the
+// given components.  iteration walks the first store so pass the smallest
+// one first.  stores that were align()ed to it are indexed directly.
+template <typename func_t, typename first_t, typename... rest_t>
+void component_each(func_t func,
+    component_store_t<first_t>& first,
+    component_store_t<rest_t>&... rest)
+{
+    const size_t count = first.size();
+    first_t* data = first.data();
+    const object_handle_t* handles = first.handles();
+    for (size_t i = 0; i < count; ++i) {
+        const object_handle_t h = handles[i];
+        if (component::aligned(i, h, rest...)) {
+            func(h, data[i], rest.data()[i]...);
+        } else if (component::has_all(h, rest...)) {
+            func(h, data[i], *rest.get(h)...);
+        }
+    }
+}
+
+} // namespace tengu
@@ -1,16 +1,106 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <deque>
-#include <set>
-#include <unordered_map>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <vector>
 
+#include "wheel.h"
+
 namespace tengu {
 
 typedef uint32_t event_type_t;
+typedef uint64_t event_mask_t;
+
+// hierarchy of event types.  a type registered with a parent is also an
+// instance of that parent and all of its ancestors.  any type which has
+// children is a category and is given one bit, and each type keeps the
+// bits of every category it belongs to, so membership is a single AND.
+struct event_registry_t {
+
+    enum : uint32_t {
+        c_max_categories = 64,
+        // types index the mask tables so must be small
+        c_max_types = 0x10000,
+        c_no_parent = 0xffffffff,
+    };
+
+    event_registry_t()
+        : categories_(0)
+    {
+    }
+
+    // register 'type' under 'parent'.  parents must be added before their
+    // children.  returns false if there are no category bits left or
+    // either type is not below c_max_types.
+    bool add(event_type_t type, event_type_t parent = c_no_parent)
+    {
+        if (type >= c_max_types ||
+            (parent != c_no_parent && parent >= c_max_types)) {
+            return false;
+        }
+        grow(type);
+        if (parent == c_no_parent) {
+            return true;
+        }
+        grow(parent);
+        if (!bit_[parent]) {
+            // parent becomes a category now it has a child
+            if (categories_ == c_max_categories) {
+                return false;
+            }
+            bit_[parent] = event_mask_t(1) << categories_++;
+            mask_[parent] |= bit_[parent];
+        }
+        mask_[type] |= mask_[parent];
+        return true;
+    }
+
+    // categories 'type' is a member of
+    event_mask_t mask(event_type_t type) const
+    {
+        return type < mask_.size() ? mask_[type] : 0;
+    }
+
+    // bit identifying 'type' as a category, zero if it has no children
+    event_mask_t bit(event_type_t type) const
+    {
+        return type < bit_.size() ? bit_[type] : 0;
+    }
+
+    // true if 'type' is 'base' or one of its descendants
+    bool is_a(event_type_t type, event_type_t base) const
+    {
+        return type == base || (mask(type) & bit(base)) != 0;
+    }
+
+    static event_registry_t& inst()
+    {
+        static event_registry_t registry;
+        return registry;
+    }
+
+protected:
+    void grow(event_type_t type)
+    {
+        assert(type < c_max_types);
+        if (type >= mask_.size()) {
+            mask_.resize(type + 1, 0);
+            bit_.resize(type + 1, 0);
+        }
+    }
+
+    std::vector<event_mask_t> mask_;
+    std::vector<event_mask_t> bit_;
+    uint32_t categories_;
+};
 
 struct event_t {
 
@@ -22,21 +112,22 @@ struct event_t {
     template <typename type_t>
     type_t& cast()
     {
-        assert(type_t::type() == type_);
+        assert(is_a<type_t>());
         return *static_cast<type_t*>(this);
     }
 
     template <typename type_t>
-    type_t& cast() const
+    const type_t& cast() const
     {
-        assert(type_t::type() == type_);
+        assert(is_a<type_t>());
         return *static_cast<const type_t*>(this);
     }
 
+    // true if this is a type_t or belongs to the type_t category
     template <typename type_t>
     bool is_a() const
     {
-        return type_t::type() == type_;
+        return event_registry_t::inst().is_a(type_, type_t::type());
     }
 
     event_type_t type() const
@@ -53,23 +144,262 @@ struct event_listener_t {
     virtual void recieve_event(const event_t*) = 0;
 };
 
+// linear allocator for queued events.  storage is kept in chunks which are
+// reused after reset() so a steady stream of events does not allocate.
+struct event_arena_t {
+
+    enum : size_t {
+        c_chunk_size = 16 * 1024,
+    };
+
+    event_arena_t()
+        : chunk_(0)
+        , offset_(0)
+    {
+    }
+
+    event_arena_t(const event_arena_t&) = delete;
+    void operator=(const event_arena_t&) = delete;
+
+    void* alloc(size_t size, size_t align)
+    {
+        for (;;) {
+            if (chunk_ < chunks_.size()) {
+                chunk_t& c = chunks_[chunk_];
+                const size_t base = (offset_ + align - 1) & ~(align - 1);
+                if (base + size <= c.size_) {
+                    offset_ = base + size;
+                    return c.data_.get() + base;
+                }
+                ++chunk_;
+                offset_ = 0;
+                continue;
+            }
+            // oversized events get a chunk of their own
+            chunk_t c;
+            c.size_ = std::max<size_t>(c_chunk_size, size + align);
+            c.data_.reset(new uint8_t[c.size_]);
+            chunks_.push_back(std::move(c));
+        }
+    }
+
+    // release everything allocated, keeping the chunks
+    void reset()
+    {
+        chunk_ = 0;
+        offset_ = 0;
+    }
+
+    // bytes of storage held by the arena
+    size_t capacity() const
+    {
+        size_t total = 0;
+        for (const chunk_t& c : chunks_) {
+            total += c.size_;
+        }
+        return total;
+    }
+
+protected:
+    struct chunk_t {
+        std::unique_ptr<uint8_t[]> data_;
+        size_t size_;
+    };
+
+    std::vector<chunk_t> chunks_;
+    size_t chunk_;
+    size_t offset_;
+};
+
+// bounded lock free ring which any number of threads can push events into
+// while a single owning thread drains it.  each slot carries a sequence
+// number which tells producers and the consumer whose turn it is.
+struct event_ring_t {
+
+    enum : size_t {
+        // largest event which fits in a slot
+        c_slot_size = 64,
+    };
+
+    // capacity must be a power of two
+    explicit event_ring_t(size_t capacity)
+        : slots_(new slot_t[capacity])
+        , mask_(capacity - 1)
+        , tail_(0)
+        , head_(0)
+    {
+        assert(capacity && (capacity & mask_) == 0);
+        for (size_t i = 0; i < capacity; ++i) {
+            slots_[i].seq_.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    event_ring_t(const event_ring_t&) = delete;
+    void operator=(const event_ring_t&) = delete;
+
+    // copy an event into the ring, returns false if the ring is full.
+    // safe to call from any thread.
+    bool push(const event_t* event, size_t size)
+    {
+        assert(size <= c_slot_size);
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            slot_t& slot = slots_[pos & mask_];
+            const size_t seq = slot.seq_.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0) {
+                // slot is free, try to claim it
+                if (tail_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    memcpy(slot.data_, event, size);
+                    slot.size_ = uint32_t(size);
+                    // publish to the consumer
+                    slot.seq_.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // the consumer has not freed this slot yet
+                return false;
+            } else {
+                // another producer took this slot
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // pass each published event to func(event, size) in ring order and
+    // free its slot.  at most one lap of the ring is drained so busy
+    // producers can not keep the caller here.  only the owning thread may
+    // drain.
+    template <typename func_t>
+    size_t drain(const func_t& func)
+    {
+        size_t count = 0;
+        for (; count <= mask_; ++count) {
+            slot_t& slot = slots_[head_ & mask_];
+            if (slot.seq_.load(std::memory_order_acquire) != head_ + 1) {
+                // empty, or a producer is still writing this slot
+                return count;
+            }
+            func(reinterpret_cast<const event_t*>(slot.data_), slot.size_);
+            // hand the slot back to producers one lap later
+            slot.seq_.store(head_ + mask_ + 1, std::memory_order_release);
+            ++head_;
+        }
+        return count;
+    }
+
+protected:
+    struct slot_t {
+        std::atomic<size_t> seq_;
+        uint32_t size_;
+        alignas(16) uint8_t data_[c_slot_size];
+    };
+
+    std::unique_ptr<slot_t[]> slots_;
+    const size_t mask_;
+    // producers and consumer indices on separate cache lines
+    uint8_t pad0_[64];
+    std::atomic<size_t> tail_;
+    uint8_t pad1_[64];
+    size_t head_;
+};
+
+// handle through which another thread posts events into an
+// event_stream_t.  the counters are only written by the posting thread
+// and may be read from any thread.
+struct event_producer_t {
+
+    event_producer_t(event_ring_t& ring)
+        : ring_(ring)
+        , posted_(0)
+        , dropped_(0)
+    {
+    }
+
+    // queue a copy of an event for the stream's next dispatch(), returns
+    // false if it was dropped because the ring was full
+    template <typename type_t>
+    bool post(const type_t& event)
+    {
+        static_assert(std::is_base_of<event_t, type_t>::value,
+            "type must derive from event_t");
+        static_assert(std::is_trivially_copyable<type_t>::value,
+            "posted events are copied as raw bytes");
+        static_assert(sizeof(type_t) <= event_ring_t::c_slot_size,
+            "event is too large to post from another thread");
+        static_assert(alignof(type_t) <= 16, "event is over aligned");
+        if (ring_.push(&event, sizeof(type_t))) {
+            posted_.store(posted_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+            return true;
+        }
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+        return false;
+    }
+
+    // events successfully posted
+    uint64_t posted() const
+    {
+        return posted_.load(std::memory_order_relaxed);
+    }
+
+    // events dropped because the ring was full
+    uint64_t dropped() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+protected:
+    event_ring_t& ring_;
+    std::atomic<uint64_t> posted_;
+    std::atomic<uint64_t> dropped_;
+    // producers are usually on different threads
+    uint8_t pad_[64];
+};
+
 struct event_stream_t {
 
-    // add a filtered listener
+    enum : size_t {
+        // slots in the ring shared by all producers
+        c_ring_size = 4096,
+        // event types index the listener table so must be small
+        c_max_types = 0x10000,
+    };
+
+    event_stream_t()
+        : sending_(0)
+        , post_(0)
+        , dispatching_(false)
+    {
+    }
+
+    // add a filtered listener.  types which are not below c_max_types are
+    // skipped and make this return false.
     template <int SIZE>
-    void add(event_listener_t* l, const std::array<event_type_t, SIZE>& filter)
+    bool add(event_listener_t* l, const std::array<event_type_t, SIZE>& filter)
     {
+        bool ok = true;
         for (int i = 0; i < SIZE; ++i) {
             const event_type_t type = filter[i];
+            if (type >= c_max_types) {
+                ok = false;
+                continue;
+            }
+            if (type >= local_.size()) {
+                local_.resize(type + 1);
+            }
             // push back this type
-            local_[type].insert(l);
+            insert(local_[type], l);
         }
+        return ok;
     }
 
     // add a global listener
     void add(event_listener_t* l)
     {
-        global_.insert(l);
+        insert(global_, l);
     }
 
     // remove a filtered listener
@@ -79,16 +409,8 @@ struct event_stream_t {
         // for each type being filtered
         for (int i = 0; i < SIZE; ++i) {
             const event_type_t type = filter[i];
-            // find it in the local map
-            auto itt = local_.find(type);
-            if (itt == local_.end()) {
-                continue;
-            }
-            // get the set for this type
-            event_set_t& vec = itt->second;
-            if (vec.find(l) != vec.end()) {
-                // erase the entry
-                vec.erase(l);
+            if (type < local_.size()) {
+                erase(type, l);
             }
         }
     }
@@ -96,35 +418,282 @@ struct event_stream_t {
     // remove a global listener
     void remove(event_listener_t* l)
     {
-        if (global_.find(l) != global_.end()) {
-            global_.erase(l);
-        }
+        erase(c_global, l);
 
         //todo: remove from all locals?
     }
 
-    // send a message to all eligible listeners
+    // add a listener for 'category' and every type registered under it
+    void add_category(event_listener_t* l, event_type_t category)
+    {
+        const event_mask_t bit = event_registry_t::inst().bit(category);
+        assert(bit && "category has no registered children");
+        for (category_listener_t& c : category_) {
+            if (c.listener_ == l) {
+                c.mask_ |= bit;
+                return;
+            }
+        }
+        const category_listener_t c = { l, bit };
+        category_.push_back(c);
+    }
+
+    // remove a category listener
+    void remove_category(event_listener_t* l, event_type_t category)
+    {
+        const event_mask_t bit = event_registry_t::inst().bit(category);
+        for (size_t i = 0; i < category_.size(); ++i) {
+            category_listener_t& c = category_[i];
+            if (c.listener_ != l) {
+                continue;
+            }
+            c.mask_ &= ~bit;
+            if (c.mask_ == 0) {
+                if (sending_) {
+                    // empty masks are compacted after sending
+                    dirty_.push_back(c_category);
+                } else {
+                    c = category_.back();
+                    category_.pop_back();
+                }
+            }
+            return;
+        }
+    }
+
+    // send a message to all eligible listeners.  listeners may be added
+    // or removed while sending, new listeners will not see this event.
     void send(const event_t* event)
     {
         assert(event);
+        ++sending_;
         // send to all global listeners first
-        for (auto* l : global_) {
-            l->recieve_event(event);
-        }
+        deliver(c_global, event);
         // send to any local listeners
-        auto itt = local_.find(event->type());
-        if (itt != local_.end()) {
-            const auto& vec = itt->second;
-            for (auto& l : vec) {
+        if (event->type() < local_.size()) {
+            deliver(event->type(), event);
+        }
+        // send to listeners of any category this event is in
+        if (!category_.empty()) {
+            deliver_category(event);
+        }
+        if (--sending_ == 0 && !dirty_.empty()) {
+            compact();
+        }
+    }
+
+    // queue a copy of an event to be sent by the next call to dispatch()
+    template <typename type_t>
+    void post(const type_t& event)
+    {
+        static_assert(std::is_base_of<event_t, type_t>::value,
+            "type must derive from event_t");
+        // the arena is reset without calling destructors
+        static_assert(std::is_trivially_destructible<type_t>::value,
+            "queued events must be trivially destructible");
+        event_queue_t& queue = queue_[post_];
+        void* mem = queue.arena_.alloc(sizeof(type_t), alignof(type_t));
+        const event_t* copy = new (mem) type_t(event);
+        const queued_event_t q = { copy->type(),
+            uint32_t(queue.events_.size()), copy };
+        queue.events_.push_back(q);
+    }
+
+    // queue a copy of an event once 'delay' ticks of 'wheel' have passed,
+    // in place of counting down in a tick().  the event is held by the
+    // timer until then, cancel it if the stream goes away first.
+    template <typename type_t>
+    timer_handle_t post_after(timer_wheel_t& wheel,
+        uint64_t delay,
+        const type_t& event)
+    {
+        return wheel.schedule(delay, [this, event]() { post(event); });
+    }
+
+    // create a handle for another thread to post events through.  the
+    // stream owns it and it lives as long as the stream.
+    event_producer_t* add_producer()
+    {
+        if (!ring_) {
+            ring_.reset(new event_ring_t(c_ring_size));
+        }
+        producer_.emplace_back(new event_producer_t(*ring_));
+        return producer_.back().get();
+    }
+
+    // send all queued events, grouped by type and in the order they were
+    // posted within each type.  events posted while dispatching are
+    // queued for the following dispatch().  returns false, doing nothing,
+    // if called from a listener while already dispatching.
+    bool dispatch()
+    {
+        if (dispatching_) {
+            return false;
+        }
+        event_queue_t& queue = queue_[post_];
+        // pick up events posted from other threads
+        if (ring_) {
+            ring_->drain([&queue](const event_t* event, size_t size) {
+                void* mem = queue.arena_.alloc(size, 16);
+                memcpy(mem, event, size);
+                const queued_event_t q = { event->type(),
+                    uint32_t(queue.events_.size()),
+                    static_cast<const event_t*>(mem) };
+                queue.events_.push_back(q);
+            });
+        }
+        // flip buffers so listeners can post while we send
+        post_ ^= 1;
+        dispatching_ = true;
+        std::sort(queue.events_.begin(), queue.events_.end());
+        for (const queued_event_t& q : queue.events_) {
+            send(q.event_);
+        }
+        dispatching_ = false;
+        queue.events_.clear();
+        queue.arena_.reset();
+        return true;
+    }
+
+    // number of events waiting for the next dispatch()
+    size_t queued() const
+    {
+        return queue_[post_].events_.size();
+    }
+
+    // bytes of arena storage held by both queues
+    size_t queue_capacity() const
+    {
+        return queue_[0].arena_.capacity() + queue_[1].arena_.capacity();
+    }
+
+protected:
+    typedef std::vector<event_listener_t*> listener_list_t;
+
+    enum : uint32_t {
+        // list id of the global and category listeners
+        c_global = 0xffffffff,
+        c_category = 0xfffffffe,
+    };
+
+    struct category_listener_t {
+        event_listener_t* listener_;
+        // categories subscribed to
+        event_mask_t mask_;
+    };
+
+    listener_list_t& list(uint32_t id)
+    {
+        return id == c_global ? global_ : local_[id];
+    }
+
+    void insert(listener_list_t& list, event_listener_t* l)
+    {
+        if (std::find(list.begin(), list.end(), l) == list.end()) {
+            list.push_back(l);
+        }
+    }
+
+    void erase(uint32_t id, event_listener_t* l)
+    {
+        listener_list_t& vec = list(id);
+        auto itt = std::find(vec.begin(), vec.end(), l);
+        if (itt == vec.end()) {
+            return;
+        }
+        if (sending_) {
+            // leave a hole until the outermost send() has finished
+            *itt = nullptr;
+            dirty_.push_back(id);
+        } else {
+            *itt = vec.back();
+            vec.pop_back();
+        }
+    }
+
+    void deliver(uint32_t id, const event_t* event)
+    {
+        // index each time around as a listener may grow the tables
+        const size_t count = list(id).size();
+        for (size_t i = 0; i < count; ++i) {
+            if (event_listener_t* l = list(id)[i]) {
                 l->recieve_event(event);
             }
         }
     }
 
-protected:
-    typedef std::set<event_listener_t*> event_set_t;
+    void deliver_category(const event_t* event)
+    {
+        const event_mask_t mask = event_registry_t::inst().mask(event->type());
+        const size_t count = category_.size();
+        for (size_t i = 0; i < count; ++i) {
+            const category_listener_t& c = category_[i];
+            if (c.mask_ & mask) {
+                c.listener_->recieve_event(event);
+            }
+        }
+    }
+
+    // swap remove the holes left by listeners removed while sending
+    void compact()
+    {
+        for (uint32_t id : dirty_) {
+            if (id == c_category) {
+                for (size_t i = 0; i < category_.size();) {
+                    if (category_[i].mask_) {
+                        ++i;
+                    } else {
+                        category_[i] = category_.back();
+                        category_.pop_back();
+                    }
+                }
+                continue;
+            }
+            listener_list_t& vec = list(id);
+            for (size_t i = 0; i < vec.size();) {
+                if (vec[i]) {
+                    ++i;
+                } else {
+                    vec[i] = vec.back();
+                    vec.pop_back();
+                }
+            }
+        }
+        dirty_.clear();
+    }
+
+    struct queued_event_t {
+        event_type_t type_;
+        // position in the queue, keeps the sort stable
+        uint32_t order_;
+        const event_t* event_;
+
+        bool operator<(const queued_event_t& rhs) const
+        {
+            return type_ != rhs.type_ ? type_ < rhs.type_
+                                      : order_ < rhs.order_;
+        }
+    };
+
+    struct event_queue_t {
+        event_arena_t arena_;
+        std::vector<queued_event_t> events_;
+    };
 
-    std::unordered_map<event_type_t, event_set_t> local_;
-    event_set_t global_;
+    // local listeners indexed by event type
+    std::vector<listener_list_t> local_;
+    listener_list_t global_;
+    std::vector<category_listener_t> category_;
+    // lists holding removed listeners to compact after sending
+    std::vector<uint32_t> dirty_;
+    // depth of nested send() calls
+    uint32_t sending_;
+    // double buffered queue, post_ selects the one being posted to
+    event_queue_t queue_[2];
+    uint32_t post_;
+    bool dispatching_;
+    // events posted from other threads
+    std::unique_ptr<event_ring_t> ring_;
+    std::vector<std::unique_ptr<event_producer_t>> producer_;
 };
 } // namespace tengu
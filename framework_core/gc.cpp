@@ -0,0 +1,439 @@
+#include <algorithm>
+#include <chrono>
+
+#include "gc.h"
+#include "jobs.h"
+#include "profile.h"
+
+namespace tengu {
+
+namespace {
+typedef std::chrono::steady_clock clock_t;
+
+enum : size_t {
+  // objects processed between checks of the clock in gc_t::step()
+  c_step_work = 64,
+  // a marker shares work once its local stack is larger than this
+  c_share_min = 32,
+};
+
+uint64_t elapsed_us(clock_t::time_point start) {
+  return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+                      clock_t::now() - start)
+                      .count());
+}
+} // namespace {}
+
+gc_t::gc_t()
+  : phase_(e_idle)
+  , epoch_(1)
+  , threads_(1)
+  , idle_(0) {
+  size_t size = c_min_size;
+  for (size_class_t &sc : class_) {
+    sc.size_ = size;
+    sc.page_ = c_large_page;
+    sc.slot_ = 0;
+    size *= 2;
+  }
+}
+
+gc_t::~gc_t() {
+  reset();
+}
+
+void gc_t::set_threads(uint32_t threads) {
+  assert(phase_ == e_idle);
+  threads_ = threads > 1 ? threads : 1;
+  if (threads_ > 1) {
+    jobs_.reset(new job_pool_t(threads_ - 1));
+    markers_.reset(new marker_t[threads_]);
+  } else {
+    jobs_.reset();
+    markers_.reset();
+  }
+}
+
+void gc_t::reset() {
+  for (gc_object_t *obj : allocs_) {
+    obj->~gc_object_t();
+  }
+  for (size_class_t &sc : class_) {
+    sc.page_ = c_large_page;
+    sc.slot_ = 0;
+    sc.recycle_.clear();
+  }
+  for (gc_header_t *hdr : large_) {
+    delete[] reinterpret_cast<uint8_t *>(hdr);
+  }
+  pages_.clear();
+  large_.clear();
+  allocs_.clear();
+  pending_.clear();
+  young_.clear();
+  remembered_.clear();
+  remembered_at_.clear();
+  phase_ = e_idle;
+}
+
+gc_header_t *gc_t::alloc_slot(size_t size) {
+  if (size > c_max_size) {
+    // big objects get their own allocation with a header in front
+    uint8_t *mem = new uint8_t[sizeof(gc_header_t) + size];
+    gc_header_t *hdr = new (mem) gc_header_t;
+    hdr->page_ = c_large_page;
+    large_.push_back(hdr);
+    return hdr;
+  }
+  // find the smallest class which fits
+  size_t index = 0;
+  while (class_[index].size_ < size) {
+    ++index;
+  }
+  size_class_t &sc = class_[index];
+  for (;;) {
+    if (sc.page_ != c_large_page) {
+      page_t &page = pages_[sc.page_];
+      // bump along the page, stepping over slots still in use
+      while (sc.slot_ < page.slots_) {
+        gc_header_t *hdr = page.slot(sc.slot_++);
+        if (!hdr->used()) {
+          ++page.live_;
+          hdr->page_ = sc.page_;
+          return hdr;
+        }
+      }
+      if (page.live_ < page.slots_) {
+        // slots behind the cursor were freed, go around again
+        sc.slot_ = 0;
+        continue;
+      }
+      page.listed_ = false;
+    }
+    if (sc.recycle_.empty()) {
+      grow(sc);
+    } else {
+      sc.page_ = sc.recycle_.back();
+      sc.recycle_.pop_back();
+    }
+    sc.slot_ = 0;
+  }
+}
+
+void gc_t::grow(size_class_t &sc) {
+  assert(pages_.size() < c_large_page);
+  page_t page;
+  page.class_ = uint8_t(&sc - class_);
+  page.stride_ = uint32_t(sizeof(gc_header_t) + sc.size_);
+  page.slots_ = uint32_t(c_page_size / page.stride_);
+  page.live_ = 0;
+  page.listed_ = true;
+  page.mem_.reset(new uint8_t[c_page_size]);
+  for (size_t i = 0; i < page.slots_; ++i) {
+    gc_header_t *hdr = new (page.slot(i)) gc_header_t;
+    hdr->flags_ = 0;
+    hdr->set_mark(0);
+  }
+  sc.page_ = uint16_t(pages_.size());
+  pages_.push_back(std::move(page));
+}
+
+void gc_t::collect() {
+  TENGU_PROFILE_ZONE("gc.collect");
+  if (phase_ == e_idle) {
+    begin_cycle();
+  }
+  if (threads_ > 1) {
+    mark_parallel();
+  } else {
+    mark(SIZE_MAX);
+  }
+  phase_ = e_sweep;
+  sweep(SIZE_MAX);
+  end_cycle();
+}
+
+bool gc_t::step(uint32_t budget_us) {
+  TENGU_PROFILE_ZONE("gc.step");
+  const clock_t::time_point start = clock_t::now();
+  uint64_t spent = 0, slice = 0;
+  if (phase_ == e_idle) {
+    begin_cycle();
+  }
+  // stop early if another slice of work would likely overrun the budget,
+  // leaving headroom for a slice that runs long
+  while (spent + slice * 2 < budget_us) {
+    if (phase_ == e_mark) {
+      if (mark(c_step_work)) {
+        phase_ = e_sweep;
+      }
+    } else {
+      if (sweep(c_step_work)) {
+        end_cycle();
+        return true;
+      }
+    }
+    const uint64_t now = elapsed_us(start);
+    slice = now - spent > slice ? now - spent : slice;
+    spent = now;
+  }
+  return false;
+}
+
+bool gc_t::collect_minor() {
+  TENGU_PROFILE_ZONE("gc.minor");
+  if (phase_ != e_idle) {
+    return false;
+  }
+  // old objects pointing at young ones act as extra roots.  every young
+  // survivor is promoted so the remembered set starts empty again.
+  for (const gc_object_t *obj : remembered_) {
+    gc_header_t *hdr = gc_header_t::from(obj);
+    hdr->flags_ &= ~gc_header_t::e_remembered;
+    hdr->enum_(obj, pending_);
+  }
+  remembered_.clear();
+  // trace young objects only, old objects are assumed live
+  while (!pending_.empty()) {
+    const gc_object_t *obj = pending_.back();
+    pending_.pop_back();
+    if (obj) {
+      gc_header_t *hdr = gc_header_t::from(obj);
+      assert(hdr->used());
+      if ((hdr->flags_ & (gc_header_t::e_old | gc_header_t::e_minor)) == 0) {
+        hdr->flags_ |= gc_header_t::e_minor;
+        hdr->enum_(obj, pending_);
+      }
+    }
+  }
+  // sweep the young objects, promoting the survivors
+  for (gc_header_t *hdr : young_) {
+    if (!hdr->used() || hdr->old()) {
+      // stale entry
+      continue;
+    }
+    if (hdr->flags_ & gc_header_t::e_minor) {
+      hdr->flags_ =
+          (hdr->flags_ & ~gc_header_t::e_minor) | gc_header_t::e_old;
+    } else {
+      release(hdr);
+    }
+  }
+  young_.clear();
+  return true;
+}
+
+void gc_t::end_cycle() {
+  // the sweep has freed everything unreachable so every young object left
+  // has survived.  promoting them means no old object can point at a young
+  // one, and the remembered set can start over empty.
+  for (gc_header_t *hdr : young_) {
+    if (hdr->used()) {
+      hdr->flags_ |= gc_header_t::e_old;
+    }
+  }
+  young_.clear();
+  for (const gc_object_t *obj : remembered_) {
+    gc_header_t::from(obj)->flags_ &= ~gc_header_t::e_remembered;
+  }
+  remembered_.clear();
+  phase_ = e_idle;
+}
+
+void gc_t::begin_cycle() {
+  // flipping the epoch turns every object white without touching it
+  epoch_ = epoch_ == 0xff ? 1 : epoch_ + 1;
+  cursor_ = cursor_t{0, 0, 0, 0};
+  phase_ = e_mark;
+}
+
+bool gc_t::mark(size_t work) {
+  // visit everything
+  while (!pending_.empty()) {
+    if (work-- == 0) {
+      return false;
+    }
+    // pop from the end of the pending list
+    const gc_object_t *obj = pending_.back();
+    pending_.pop_back();
+    if (obj) {
+      gc_header_t *hdr = gc_header_t::from(obj);
+      assert(hdr->used());
+      // if we have not visited this yet
+      if (hdr->mark() != epoch_) {
+        // mark it and enumerate its children
+        hdr->set_mark(epoch_);
+        hdr->enum_(obj, pending_);
+      }
+    }
+  }
+  return true;
+}
+
+void gc_t::mark_parallel() {
+  // deal the grey objects out between the markers
+  for (size_t i = 0; i < pending_.size(); ++i) {
+    markers_[i % threads_].shared_.push_back(pending_[i]);
+  }
+  pending_.clear();
+  for (uint32_t i = 0; i < threads_; ++i) {
+    marker_t &m = markers_[i];
+    m.available_.store(m.shared_.size());
+  }
+  idle_.store(0);
+  jobs_->parallel_for(threads_, 1, [this](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      mark_worker(i);
+    }
+  });
+}
+
+void gc_t::mark_worker(size_t id) {
+  marker_t &m = markers_[id];
+  std::vector<const gc_object_t *> &local = m.local_;
+  const uint8_t epoch = epoch_;
+  do {
+    while (!local.empty()) {
+      const gc_object_t *obj = local.back();
+      local.pop_back();
+      if (obj) {
+        gc_header_t *hdr = gc_header_t::from(obj);
+        assert(hdr->used());
+        // the atomic mark decides which thread traces this object
+        if (hdr->try_mark(epoch)) {
+          hdr->enum_(obj, local);
+          // publish work once our shared stack has been drained
+          if (local.size() > c_share_min &&
+              m.available_.load(std::memory_order_relaxed) == 0) {
+            share(m);
+          }
+        }
+      }
+    }
+  } while (refill(id));
+}
+
+bool gc_t::refill(size_t id) {
+  marker_t &m = markers_[id];
+  // take back our own shared work first, then try to steal
+  if (take(m, m, false)) {
+    return true;
+  }
+  for (uint32_t i = 1; i < threads_; ++i) {
+    if (take(markers_[(id + i) % threads_], m, true)) {
+      return true;
+    }
+  }
+  // marking is done once every marker is idle.  only a busy marker can
+  // share new work so while any are busy keep looking for some.
+  idle_.fetch_add(1);
+  for (;;) {
+    if (idle_.load() == threads_) {
+      return false;
+    }
+    for (uint32_t i = 0; i < threads_; ++i) {
+      marker_t &victim = markers_[i];
+      if (victim.available_.load(std::memory_order_relaxed)) {
+        idle_.fetch_sub(1);
+        if (take(victim, m, true)) {
+          return true;
+        }
+        idle_.fetch_add(1);
+      }
+    }
+    yield();
+  }
+}
+
+void gc_t::share(marker_t &m) {
+  // give away the bottom half of the stack, nearest the roots
+  std::vector<const gc_object_t *> &local = m.local_;
+  const size_t count = local.size() / 2;
+  scope_lock_t<spinlock_t> guard(m.lock_);
+  m.shared_.insert(m.shared_.end(), local.begin(), local.begin() + count);
+  local.erase(local.begin(), local.begin() + count);
+  m.available_.store(m.shared_.size());
+}
+
+bool gc_t::take(marker_t &from, marker_t &to, bool half) {
+  if (from.available_.load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+  scope_lock_t<spinlock_t> guard(from.lock_);
+  std::vector<const gc_object_t *> &shared = from.shared_;
+  if (shared.empty()) {
+    return false;
+  }
+  const size_t count = half ? (shared.size() + 1) / 2 : shared.size();
+  to.local_.insert(to.local_.end(), shared.end() - count, shared.end());
+  shared.resize(shared.size() - count);
+  from.available_.store(shared.size());
+  return true;
+}
+
+bool gc_t::sweep(size_t work) {
+  // linear pass over the arenas, resuming from the cursor
+  cursor_t &c = cursor_;
+  for (; c.page_ < pages_.size(); ++c.page_, c.slot_ = 0) {
+    page_t &page = pages_[c.page_];
+    for (; c.slot_ < page.slots_; ++c.slot_) {
+      if (work-- == 0) {
+        return false;
+      }
+      gc_header_t *hdr = page.slot(c.slot_);
+      if (hdr->used() && hdr->mark() != epoch_) {
+        release(hdr);
+      }
+    }
+  }
+  // compact the large allocation list
+  for (; c.large_ < large_.size(); ++c.large_) {
+    if (work-- == 0) {
+      return false;
+    }
+    gc_header_t *hdr = large_[c.large_];
+    if (hdr->mark() == epoch_) {
+      large_[c.keep_++] = hdr;
+    } else {
+      release(hdr);
+    }
+  }
+  large_.resize(c.keep_);
+  return true;
+}
+
+void gc_t::release(gc_header_t *hdr) {
+  const uint32_t index = hdr->index_;
+  if (hdr->flags_ & gc_header_t::e_remembered) {
+    // swap remove from the remembered set by the position kept for it
+    const uint32_t at = remembered_at_[index];
+    assert(remembered_[at] == hdr->object());
+    const gc_object_t *moved = remembered_.back();
+    remembered_[at] = moved;
+    remembered_at_[gc_header_t::from(moved)->index_] = at;
+    remembered_.pop_back();
+  }
+  // swap remove from the allocation list
+  gc_object_t *last = allocs_.back();
+  gc_header_t::from(last)->index_ = index;
+  allocs_[index] = last;
+  allocs_.pop_back();
+  remembered_at_[index] = remembered_at_.back();
+  remembered_at_.pop_back();
+  // delete the object
+  hdr->object()->~gc_object_t();
+  hdr->flags_ = 0;
+  if (hdr->page_ == c_large_page) {
+    delete[] reinterpret_cast<uint8_t *>(hdr);
+    return;
+  }
+  // make the page available for allocation again
+  page_t &page = pages_[hdr->page_];
+  --page.live_;
+  if (!page.listed_) {
+    page.listed_ = true;
+    class_[page.class_].recycle_.push_back(hdr->page_);
+  }
+}
+
+} // namespace tengu
@@ -1,12 +1,19 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <vector>
-#include <unordered_map>
-#include <unordered_set>
+
+#include "thread.h"
 
 namespace tengu {
 
+struct job_pool_t;
+
 struct gc_object_t {
 
   // static void gc_enum_t(const gc_object_t *obj, std::vector<const gc_object_t *> &live);
@@ -20,95 +27,319 @@ typedef void(*gc_enum_t)(
   std::vector<const gc_object_t *> &);
 
 
-struct gc_t {
+// header placed directly in front of every gc allocation
+struct gc_header_t {
+
+  enum : uint8_t {
+    // slot holds a live allocation
+    e_used = 1,
+    // survived a minor collection
+    e_old = 2,
+    // old object in gc_t::remembered_
+    e_remembered = 4,
+    // reached during a minor collection
+    e_minor = 8,
+  };
 
-  ~gc_t() {
-    reset();
+  union {
+    // object enumeration function
+    gc_enum_t enum_;
+    // pads the pointer to 8 bytes on 32 bit targets so the header,
+    // and so the object after it, keeps the same size and alignment
+    uint64_t enum_pad_;
+  };
+  // epoch of the last cycle to reach this object
+  std::atomic<uint8_t> mark_;
+  uint8_t flags_;
+  // arena page holding this allocation or c_large_page
+  uint16_t page_;
+  // position in gc_t::allocs_
+  uint32_t index_;
+
+  bool used() const {
+    return (flags_ & e_used) != 0;
   }
 
-  void reset() {
-    for (auto *p : allocs_) {
-      delete p;
-    }
-    allocs_.clear();
-    pending_.clear();
-    marked_.clear();
-    enums_.clear();
+  bool old() const {
+    return (flags_ & e_old) != 0;
+  }
+
+  uint8_t mark() const {
+    return mark_.load(std::memory_order_relaxed);
+  }
+
+  void set_mark(uint8_t epoch) {
+    mark_.store(epoch, std::memory_order_relaxed);
+  }
+
+  // mark for 'epoch', returns false if it was already marked.  safe to
+  // race with other marking threads.
+  bool try_mark(uint8_t epoch) {
+    return mark() != epoch &&
+           mark_.exchange(epoch, std::memory_order_relaxed) != epoch;
+  }
+
+  gc_object_t *object() {
+    return reinterpret_cast<gc_object_t *>(this + 1);
   }
 
+  static gc_header_t *from(const gc_object_t *obj) {
+    return const_cast<gc_header_t *>(
+        reinterpret_cast<const gc_header_t *>(obj) - 1);
+  }
+};
+
+static_assert(sizeof(gc_header_t) == 16, "gc_header_t should be 16 bytes");
+
+// generational tri-colour collector.
+//
+// white objects have a mark_ from an older epoch, grey objects are marked
+// and waiting in pending_, black objects are marked and have had their
+// children enumerated.  a full cycle can run to completion with collect()
+// or be spread over many frames with step().
+//
+// new objects are young and are bump allocated from the arena pages of
+// their size class.  collect_minor() traces only young objects, from the
+// checked in roots and the remembered set of old objects which point at
+// young ones, and promotes the survivors in place.  objects are never
+// moved so pointers to them stay valid.
+//
+// after construction, pointer fields of gc objects must be assigned through
+// write().  it shades the overwritten reference while an incremental cycle
+// is marking (snapshot at the beginning) and remembers old owners of young
+// references.  objects allocated during a cycle are black and survive it.
+//
+// the mark phase of collect() can be spread over several threads with
+// set_threads(), in which case gc_enum functions may be called
+// concurrently and must only read the object.
+struct gc_t {
+
+  enum : uint16_t {
+    c_large_page = 0xffff,
+  };
+
+  enum : size_t {
+    // object sizes served by each arena size class
+    c_num_classes = 6,
+    c_min_size = 32,
+    c_max_size = c_min_size << (c_num_classes - 1),
+    // bytes per arena page
+    c_page_size = 64 * 1024,
+  };
+
+  enum phase_t {
+    e_idle,
+    e_mark,
+    e_sweep,
+  };
+
+  gc_t();
+
+  ~gc_t();
+
+  gc_t(const gc_t &) = delete;
+  void operator=(const gc_t &) = delete;
+
+  void reset();
+
   template <class T, class... Types> T *alloc(Types &&... args) {
     // check allocation derives from gc_object_t
     static_assert(std::is_base_of<gc_object_t, T>::value,
                   "type must derive from gc_object_t");
-    // perform the allocation and call constructor
-    T *obj = new T(std::forward<Types>(args)...);
+    static_assert(alignof(T) <= sizeof(gc_header_t),
+                  "type is over aligned for the gc arenas");
+    // carve out a slot and call constructor
+    gc_header_t *hdr = alloc_slot(sizeof(T));
+    T *obj = new (hdr->object()) T(std::forward<Types>(args)...);
+    // the header is found from the gc_object_t pointer so it must sit
+    // at the start of the allocation
+    assert(static_cast<gc_object_t *>(obj) == hdr->object());
     // add the garbage collector enumerator
-    enums_[obj] = T::gc_enum;
+    hdr->enum_ = T::gc_enum;
+    // allocate black so a cycle in progress will not free it
+    hdr->set_mark(epoch_);
+    if (hdr->page_ == c_large_page) {
+      // large objects start old, but their constructor may have stored
+      // young references without a write barrier
+      hdr->flags_ = gc_header_t::e_used | gc_header_t::e_old |
+                    gc_header_t::e_remembered;
+    } else {
+      hdr->flags_ = gc_header_t::e_used;
+      young_.push_back(hdr);
+    }
     // add to 'allocated' list
+    hdr->index_ = uint32_t(allocs_.size());
     allocs_.push_back(obj);
+    remembered_at_.push_back(0);
+    if (hdr->flags_ & gc_header_t::e_remembered) {
+      add_remembered(obj);
+    }
     return obj;
   }
 
-  // perform a full sweep and collection
-  void collect() {
-    // visit everything
-    while (!pending_.empty()) {
-      // pop from the end of the pending list
-      const gc_object_t *obj = pending_.back();
-      pending_.pop_back();
-      if (obj) {
-        // if we have not visited this yet
-        if (marked_.find(obj) == marked_.end()) {
-          // mark it
-          marked_.insert(obj);
-          // enumerate its children
-          auto itt = enums_.find(obj);
-          assert(itt != enums_.end());
-          if (itt != enums_.end()) {
-            itt->second(obj, pending_);
-          }
-        }
-      }
-    }
-    // delete redundant allocs
-    for (auto itt = allocs_.begin(); itt != allocs_.end();) {
-      if (marked_.find(*itt) == marked_.end()) {
-        // erase the enumerator
-        auto e = enums_.find(*itt);
-        assert(e != enums_.end());
-        enums_.erase(e);
-        // delete the object
-        assert(*itt);
-        delete *itt;
-        itt = allocs_.erase(itt);
-      } else {
-        ++itt;
-      }
-    }
-    // clear ready for next time
-    pending_.clear();
-    marked_.clear();
-  }
+  // perform a full sweep and collection.  if an incremental cycle is in
+  // progress it is run to completion instead.
+  void collect();
+
+  // do at most 'budget_us' microseconds of incremental collection work,
+  // starting a new cycle from the checked in roots if none is running.
+  // returns true when a cycle completed during this step.
+  bool step(uint32_t budget_us);
+
+  // number of threads used to mark in collect(), where 1 marks on the
+  // calling thread only
+  void set_threads(uint32_t threads);
+
+  // collect young objects only and promote those that survive.  returns
+  // false without doing anything while an incremental cycle is running.
+  bool collect_minor();
 
   // check in a known live object
   void check_in(const gc_object_t *obj) {
     pending_.push_back(obj);
   }
 
+  // write barrier, shade a reference that is about to be overwritten
+  void shade(const gc_object_t *obj) {
+    if (phase_ == e_mark && obj && gc_header_t::from(obj)->mark() != epoch_) {
+      pending_.push_back(obj);
+    }
+  }
+
+  // write barrier, record an old object which now points at a young one
+  void remember(const gc_object_t *owner, const gc_object_t *obj) {
+    gc_header_t *hdr = gc_header_t::from(owner);
+    if (obj && (hdr->flags_ & (gc_header_t::e_old | gc_header_t::e_remembered)) ==
+                   gc_header_t::e_old &&
+        !gc_header_t::from(obj)->old()) {
+      hdr->flags_ |= gc_header_t::e_remembered;
+      add_remembered(owner);
+    }
+  }
+
+  // overwrite a pointer field held by the gc object 'owner'
+  template <class T, class U>
+  void write(const gc_object_t *owner, T *&field, U *value) {
+    shade(field);
+    remember(owner, value);
+    field = value;
+  }
+
+  phase_t phase() const {
+    return phase_;
+  }
+
+  // number of allocations since the last minor or full collection
+  size_t young() const {
+    return young_.size();
+  }
+
   // return the list of allocations
   const std::vector<gc_object_t *> &allocs() const {
     return allocs_;
   }
 
 protected:
-  // object enumeration functions
-  std::unordered_map<const gc_object_t *, gc_enum_t> enums_;
+  struct page_t {
+    std::unique_ptr<uint8_t[]> mem_;
+    // number of slots in this page and bytes per slot
+    uint32_t slots_;
+    uint32_t stride_;
+    // number of used slots
+    uint32_t live_;
+    // size class this page is carved up for
+    uint8_t class_;
+    // page is being allocated from or is in its class recycle list
+    bool listed_;
+
+    gc_header_t *slot(size_t i) const {
+      return reinterpret_cast<gc_header_t *>(mem_.get() + i * stride_);
+    }
+  };
+
+  struct size_class_t {
+    // object bytes served by this class
+    size_t size_;
+    // page and slot being bump allocated from
+    uint16_t page_;
+    uint32_t slot_;
+    // pages which have had slots freed
+    std::vector<uint16_t> recycle_;
+  };
+
+  // per thread state for parallel marking.  each marker works from its
+  // private stack and publishes surplus work to its shared stack where
+  // other markers can steal it.
+  struct marker_t {
+    std::vector<const gc_object_t *> local_;
+    std::vector<const gc_object_t *> shared_;
+    // shared_.size() readable without taking the lock
+    std::atomic<size_t> available_;
+    spinlock_t lock_;
+    // keep markers on separate cache lines
+    uint8_t pad_[64];
+  };
+
+  // resumable position of the sweep
+  struct cursor_t {
+    size_t page_;
+    size_t slot_;
+    // read and write index while compacting large_
+    size_t large_;
+    size_t keep_;
+  };
+
+  gc_header_t *alloc_slot(size_t size);
+  void grow(size_class_t &sc);
+  // flip the epoch so every object is white and the roots are grey
+  void begin_cycle();
+  // mark and sweep at most 'work' objects, return true when done
+  bool mark(size_t work);
+  bool sweep(size_t work);
+  // mark everything using all of the markers
+  void mark_parallel();
+  void mark_worker(size_t id);
+  // refill an empty marker's local stack, returns false when marking is
+  // complete
+  bool refill(size_t id);
+  void share(marker_t &m);
+  bool take(marker_t &from, marker_t &to, bool half);
+  // finish a full cycle, everything left is live so promote it all
+  void end_cycle();
+  // destroy the object in a slot and return it to its page
+  void release(gc_header_t *hdr);
+
+  void add_remembered(const gc_object_t *obj) {
+    remembered_at_[gc_header_t::from(obj)->index_] = uint32_t(remembered_.size());
+    remembered_.push_back(obj);
+  }
+
+  size_class_t class_[c_num_classes];
+  std::vector<page_t> pages_;
+  // allocations too big for any size class
+  std::vector<gc_header_t *> large_;
   // all objects that have been allocated
   std::vector<gc_object_t *> allocs_;
-  // objects we have visited
-  std::unordered_set<const gc_object_t *> marked_;
-  // objects we need to visit
+  // grey objects we need to visit
   std::vector<const gc_object_t *> pending_;
+  // young allocations since the last minor or full collection.  may hold
+  // stale entries for slots freed by an incremental sweep, which are
+  // skipped when the list is next walked.
+  std::vector<gc_header_t *> young_;
+  // old objects which may point at young ones
+  std::vector<const gc_object_t *> remembered_;
+  // position in remembered_ of each object in allocs_, only meaningful
+  // while it is flagged e_remembered.  kept beside allocs_ rather than in
+  // the header so headers stay 16 bytes.
+  std::vector<uint32_t> remembered_at_;
+  phase_t phase_;
+  uint8_t epoch_;
+  cursor_t cursor_;
+  // parallel marking state
+  std::unique_ptr<job_pool_t> jobs_;
+  std::unique_ptr<marker_t[]> markers_;
+  uint32_t threads_;
+  std::atomic<uint32_t> idle_;
 };
 
 } // namespace tengu
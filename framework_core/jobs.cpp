@@ -0,0 +1,353 @@
+#include "jobs.h"
+
+namespace tengu {
+
+struct job_t {
+    job_pool_t::job_func_t func_;
+    // set for parallel_for jobs which cover [begin_, end_)
+    const job_pool_t::range_func_t* range_;
+    size_t begin_, end_, grain_;
+    // decremented when this job finishes
+    job_counter_t* signal_;
+};
+
+namespace {
+enum : size_t {
+    // attempts to find work before a worker goes to sleep
+    c_spin = 64,
+    // finished jobs kept per thread for reuse
+    c_cache_size = 4096,
+};
+
+// pool and worker index of the current thread
+thread_local const job_pool_t* tls_pool = nullptr;
+thread_local uint32_t tls_index = 0;
+
+// per thread free list of jobs so a steady stream of jobs does not
+// allocate
+struct job_cache_t {
+
+    ~job_cache_t()
+    {
+        for (job_t* job : free_) {
+            delete job;
+        }
+    }
+
+    job_t* alloc()
+    {
+        if (free_.empty()) {
+            return new job_t;
+        }
+        job_t* job = free_.back();
+        free_.pop_back();
+        return job;
+    }
+
+    void free(job_t* job)
+    {
+        job->func_ = nullptr;
+        if (free_.size() < c_cache_size) {
+            free_.push_back(job);
+        } else {
+            delete job;
+        }
+    }
+
+    std::vector<job_t*> free_;
+};
+
+thread_local job_cache_t tls_cache;
+} // namespace {}
+
+bool job_deque_t::push(job_t* job)
+{
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_acquire);
+    if (b - t >= c_capacity) {
+        return false;
+    }
+    slot_[b & (c_capacity - 1)].store(job, std::memory_order_relaxed);
+    // publish the job to thieves
+    bottom_.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+job_t* job_deque_t::pop()
+{
+    const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    // claim the bottom slot before looking at top, seq_cst orders the
+    // store before the load without a separate fence
+    bottom_.store(b, std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_seq_cst);
+    if (t > b) {
+        // empty
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    job_t* job = slot_[b & (c_capacity - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+        // last job, race any thieves for it
+        if (!top_.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+job_t* job_deque_t::steal()
+{
+    int64_t t = top_.load(std::memory_order_seq_cst);
+    const int64_t b = bottom_.load(std::memory_order_seq_cst);
+    if (t >= b) {
+        return nullptr;
+    }
+    job_t* job = slot_[t & (c_capacity - 1)].load(std::memory_order_relaxed);
+    // lost the race to the owner or another thief
+    if (!top_.compare_exchange_strong(t, t + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return job;
+}
+
+job_pool_t::job_pool_t(uint32_t workers)
+    : workers_(workers)
+    , deque_(new job_deque_t[workers ? workers : 1])
+    , injected_(0)
+    , signal_(0)
+    , sleeping_(0)
+    , stop_(false)
+{
+    thread_.reserve(workers);
+    for (uint32_t i = 0; i < workers; ++i) {
+        thread_.emplace_back(&job_pool_t::worker_main, this, i);
+    }
+}
+
+job_pool_t::~job_pool_t()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock_);
+        stop_ = true;
+        signal_.fetch_add(1);
+    }
+    wake_.notify_all();
+    for (std::thread& t : thread_) {
+        t.join();
+    }
+    for (job_t* job : inject_) {
+        delete job;
+    }
+}
+
+uint32_t job_pool_t::hardware_workers()
+{
+    const uint32_t count = std::thread::hardware_concurrency();
+    return count > 1 ? count - 1 : 0;
+}
+
+uint32_t job_pool_t::self() const
+{
+    return tls_pool == this ? tls_index : c_external;
+}
+
+void job_pool_t::run(const job_func_t& func,
+    job_counter_t* signal,
+    job_counter_t* after)
+{
+    job_t* job = tls_cache.alloc();
+    job->func_ = func;
+    job->range_ = nullptr;
+    job->signal_ = signal;
+    if (signal) {
+        signal->count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (after) {
+        // park the job on the counter, the last job to finish will
+        // schedule it
+        scope_lock_t<spinlock_t> guard(after->lock_);
+        if (!after->done()) {
+            after->waiting_.push_back(job);
+            return;
+        }
+    }
+    schedule(job);
+}
+
+void job_pool_t::wait(job_counter_t& counter)
+{
+    const uint32_t index = self();
+    while (!counter.done()) {
+        if (!run_one(index)) {
+            yield();
+        }
+    }
+    // the job which took the count to zero may still hold the lock
+    scope_lock_t<spinlock_t> guard(counter.lock_);
+}
+
+void job_pool_t::parallel_for(size_t count,
+    size_t grain,
+    const range_func_t& func)
+{
+    grain = grain ? grain : 1;
+    // not worth waking the workers for a single chunk
+    if (workers_ == 0 || count <= grain) {
+        if (count) {
+            func(0, count);
+        }
+        return;
+    }
+    job_counter_t counter;
+    counter.count_.store(1, std::memory_order_relaxed);
+    job_t* job = tls_cache.alloc();
+    job->range_ = &func;
+    job->begin_ = 0;
+    job->end_ = count;
+    job->grain_ = grain;
+    job->signal_ = &counter;
+    // start splitting on this thread straight away
+    execute(job);
+    wait(counter);
+}
+
+void job_pool_t::schedule(job_t* job)
+{
+    const uint32_t index = self();
+    if (index == c_external || !deque_[index].push(job)) {
+        std::lock_guard<std::mutex> guard(inject_lock_);
+        inject_.push_back(job);
+        injected_.fetch_add(1);
+    }
+    signal_.fetch_add(1);
+    if (sleeping_.load()) {
+        { std::lock_guard<std::mutex> guard(sleep_lock_); }
+        wake_.notify_one();
+    }
+}
+
+job_t* job_pool_t::find_job(uint32_t index)
+{
+    job_t* job = nullptr;
+    // newest local work first as it is likely still in cache
+    if (index != c_external) {
+        job = deque_[index].pop();
+    }
+    if (!job && injected_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> guard(inject_lock_);
+        if (!inject_.empty()) {
+            job = inject_.front();
+            inject_.pop_front();
+            injected_.fetch_sub(1);
+        }
+    }
+    // steal the oldest work from the other workers
+    const uint32_t count = workers_;
+    for (uint32_t i = 1; !job && i <= count; ++i) {
+        const uint32_t victim = (index == c_external ? i : index + i) % count;
+        if (victim != index) {
+            job = deque_[victim].steal();
+        }
+    }
+    return job;
+}
+
+bool job_pool_t::run_one(uint32_t index)
+{
+    job_t* job = find_job(index);
+    if (!job) {
+        return false;
+    }
+    execute(job);
+    return true;
+}
+
+void job_pool_t::execute(job_t* job)
+{
+    if (job->range_) {
+        // hand off the top half of the range until what is left fits
+        // in a single chunk
+        while (job->end_ - job->begin_ > job->grain_) {
+            const size_t mid = job->begin_ + (job->end_ - job->begin_) / 2;
+            job_t* half = tls_cache.alloc();
+            half->range_ = job->range_;
+            half->begin_ = mid;
+            half->end_ = job->end_;
+            half->grain_ = job->grain_;
+            half->signal_ = job->signal_;
+            job->signal_->count_.fetch_add(1, std::memory_order_relaxed);
+            job->end_ = mid;
+            schedule(half);
+        }
+        (*job->range_)(job->begin_, job->end_);
+    } else {
+        job->func_();
+    }
+    job_counter_t* signal = job->signal_;
+    tls_cache.free(job);
+    if (signal) {
+        finish(signal);
+    }
+}
+
+void job_pool_t::finish(job_counter_t* counter)
+{
+    // while other jobs are outstanding the counter can not reach zero,
+    // so it can be decremented without the lock
+    uint32_t count = counter->count_.load(std::memory_order_relaxed);
+    while (count > 1) {
+        if (counter->count_.compare_exchange_weak(count, count - 1,
+                std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+    // probably the last job.  take the lock so a waiter can not see zero
+    // and destroy the counter before we are done with it.
+    std::vector<job_t*> ready;
+    {
+        scope_lock_t<spinlock_t> guard(counter->lock_);
+        if (counter->count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            ready.swap(counter->waiting_);
+        }
+    }
+    for (job_t* job : ready) {
+        schedule(job);
+    }
+}
+
+void job_pool_t::worker_main(uint32_t index)
+{
+    tls_pool = this;
+    tls_index = index;
+    for (;;) {
+        const uint64_t seen = signal_.load();
+        // look for work for a little while before sleeping
+        bool found = false;
+        for (size_t i = 0; i < c_spin && !found; ++i) {
+            found = run_one(index);
+            if (!found) {
+                yield();
+            }
+        }
+        if (found) {
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleep_lock_);
+        if (stop_) {
+            return;
+        }
+        ++sleeping_;
+        wake_.wait(guard, [&]() {
+            return stop_ || signal_.load() != seen;
+        });
+        --sleeping_;
+        if (stop_) {
+            return;
+        }
+    }
+}
+
+} // namespace tengu
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread.h"
+
+namespace tengu {
+
+struct job_t;
+struct job_pool_t;
+
+// counts outstanding jobs.  a job run with a counter increments it when
+// submitted and decrements it when finished, and jobs can be made to wait
+// until a counter reaches zero before they start.
+struct job_counter_t {
+
+    job_counter_t()
+        : count_(0)
+    {
+    }
+
+    job_counter_t(const job_counter_t&) = delete;
+    void operator=(const job_counter_t&) = delete;
+
+    ~job_counter_t()
+    {
+        assert(done() && waiting_.empty());
+    }
+
+    bool done() const
+    {
+        return count_.load(std::memory_order_acquire) == 0;
+    }
+
+protected:
+    friend struct job_pool_t;
+
+    std::atomic<uint32_t> count_;
+    // jobs waiting for this counter to reach zero
+    spinlock_t lock_;
+    std::vector<job_t*> waiting_;
+};
+
+// fixed size work stealing deque (chase-lev).  the owning worker pushes and
+// pops at the bottom while any other thread may steal from the top.
+struct job_deque_t {
+
+    enum : int64_t {
+        c_capacity = 4096,
+    };
+
+    job_deque_t()
+        : top_(0)
+        , bottom_(0)
+    {
+        for (auto& slot : slot_) {
+            slot.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    // owner only, returns false when full
+    bool push(job_t* job);
+
+    // owner only, take the most recently pushed job
+    job_t* pop();
+
+    // any thread, take the oldest job
+    job_t* steal();
+
+    bool empty() const
+    {
+        return top_.load(std::memory_order_relaxed) >= bottom_.load(std::memory_order_relaxed);
+    }
+
+protected:
+    std::atomic<int64_t> top_;
+    // keep the thieves' and owner's indices on separate cache lines
+    uint8_t pad_[64];
+    std::atomic<int64_t> bottom_;
+    std::atomic<job_t*> slot_[c_capacity];
+};
+
+// fixed pool of worker threads used to fan work out across cores.  each
+// worker owns a deque of jobs and steals from the others when it runs
+// dry.  threads outside the pool submit through a shared queue and help
+// run jobs while they wait.
+struct job_pool_t {
+
+    typedef std::function<void()> job_func_t;
+    typedef std::function<void(size_t begin, size_t end)> range_func_t;
+
+    // construct with a given number of worker threads.  zero workers
+    // is valid and runs all work on the calling thread.
+    explicit job_pool_t(uint32_t workers);
+
+    ~job_pool_t();
+
+    job_pool_t(const job_pool_t&) = delete;
+    void operator=(const job_pool_t&) = delete;
+
+    // run func on the pool.  'signal' is incremented now and decremented
+    // once func has returned.  if 'after' is given func does not start
+    // until it has reached zero.
+    void run(const job_func_t& func,
+        job_counter_t* signal = nullptr,
+        job_counter_t* after = nullptr);
+
+    // help run jobs until counter reaches zero
+    void wait(job_counter_t& counter);
+
+    // call func over [0, count) in chunks of at most grain indices.  the
+    // range is split in half recursively so idle workers steal large
+    // pieces.  blocks until every index has been processed.
+    void parallel_for(size_t count, size_t grain, const range_func_t& func);
+
+    // number of worker threads (excluding the calling thread)
+    uint32_t workers() const
+    {
+        return workers_;
+    }
+
+    // suggested worker count for this machine
+    static uint32_t hardware_workers();
+
+protected:
+    void worker_main(uint32_t index);
+    // queue a job which is ready to run
+    void schedule(job_t* job);
+    // find and run a single job, returns false if none could be found
+    bool run_one(uint32_t index);
+    job_t* find_job(uint32_t index);
+    void execute(job_t* job);
+    void finish(job_counter_t* counter);
+    // worker index of the calling thread or c_external
+    uint32_t self() const;
+
+    enum : uint32_t {
+        c_external = 0xffffffff,
+    };
+
+    // fixed before the workers start so they can read it without a lock
+    const uint32_t workers_;
+    std::vector<std::thread> thread_;
+    std::unique_ptr<job_deque_t[]> deque_;
+
+    // jobs submitted from outside the pool
+    std::mutex inject_lock_;
+    std::deque<job_t*> inject_;
+    std::atomic<size_t> injected_;
+
+    // sleeping workers wait for signal_ to change
+    std::mutex sleep_lock_;
+    std::condition_variable wake_;
+    std::atomic<uint64_t> signal_;
+    std::atomic<uint32_t> sleeping_;
+    bool stop_;
+};
+
+} // namespace tengu
@@ -1,94 +1,655 @@
 #include "objects.h"
+#include "jobs.h"
+#include "profile.h"
 #include <algorithm>
 
 namespace tengu {
+namespace {
+bool is_ordered(const std::vector<object_t*>& obj)
+{
+    for (size_t i = 1; i < obj.size(); ++i) {
+        if (object_t::compare(obj[i], obj[i - 1])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// stable lsd radix sort on order_, four passes of eight bits.  passes
+// where every key shares the same digit are skipped which is the common
+// case since orders tend to be small enum values.
+void radix_sort(std::vector<object_t*>& obj, std::vector<object_t*>& temp)
+{
+    const size_t count = obj.size();
+    // map signed order onto unsigned keys that sort the same way
+    auto key = [](const object_t* o) {
+        return uint32_t(o->order()) ^ 0x80000000u;
+    };
+    uint32_t hist[4][256];
+    memset(hist, 0, sizeof(hist));
+    for (const object_t* o : obj) {
+        const uint32_t k = key(o);
+        ++hist[0][(k >> 0) & 0xff];
+        ++hist[1][(k >> 8) & 0xff];
+        ++hist[2][(k >> 16) & 0xff];
+        ++hist[3][(k >> 24) & 0xff];
+    }
+    temp.resize(count);
+    for (uint32_t pass = 0; pass < 4; ++pass) {
+        uint32_t* h = hist[pass];
+        const uint32_t shift = pass * 8;
+        // skip this pass if all keys land in one bucket
+        if (h[(key(obj[0]) >> shift) & 0xff] == count) {
+            continue;
+        }
+        // convert histogram to bucket offsets
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < 256; ++i) {
+            const uint32_t c = h[i];
+            h[i] = sum;
+            sum += c;
+        }
+        for (object_t* o : obj) {
+            temp[h[(key(o) >> shift) & 0xff]++] = o;
+        }
+        obj.swap(temp);
+    }
+}
+} // namespace {}
+
 object_ref_t object_t::get_ref()
 {
     return object_ref_t(this);
 }
 
-void object_factory_t::add_creator(
+bool object_factory_t::add_creator(
     object_type_t type,
     object_factory_t::creator_t* creator)
 {
-    creator_[type] = std::unique_ptr<creator_t>(creator);
+    std::unique_ptr<creator_t> owned(creator);
+    // object types should be small and dense
+    if (type >= c_max_types) {
+        return false;
+    }
+    if (type >= creator_.size()) {
+        creator_.resize(type + 1);
+    }
+    creator_[type].creator_ = std::move(owned);
+    return true;
 }
 
 object_ref_t object_factory_t::create(object_type_t type)
 {
-    auto itt = creator_.find(type);
-    if (itt == creator_.end()) {
+    // objects ticking in parallel may create new objects
+    if (jobs_) {
+        scope_lock_t<spinlock_t> guard(stage_lock_);
+        return create_(type);
+    }
+    return create_(type);
+}
+
+object_ref_t object_factory_t::create_(object_type_t type)
+{
+    creator_t* creator = find_creator(type);
+    if (!creator) {
+        return object_ref_t();
+    }
+    // take a handle first so nothing is made if the table is full
+    const object_handle_t handle = alloc_handle();
+    if (!handle.valid()) {
         return object_ref_t();
     } else {
-        assert(itt->second);
-        object_t* obj = itt->second->create(type, service_);
+        object_t* obj = creator->create(type, service_);
+        obj->handle_ = handle;
+        handle_[handle.index()].obj_ = obj;
         stage_.push_back(obj);
+        ++creator_[type].stats_.created_;
         return object_ref_t(obj);
     }
 }
 
-void object_factory_t::sort()
+bool object_factory_t::occupancy(object_type_t type,
+    size_t& used,
+    size_t& capacity) const
 {
-    const size_t count = obj_.size();
-    // shuffle into the correct position.  while not a great sort
-    // its reasonable for the general case where the list is mostly
-    // ordered.
-    for (size_t i = 1; i < count; ++i) {
-        size_t j = i;
-        while (j >= 1 && object_t::compare(obj_[j], obj_[j - 1])) {
-            std::swap(obj_[j - 1], obj_[j]);
-            --j;
+    const creator_t* creator = find_creator(type);
+    if (!creator) {
+        return false;
+    }
+    return creator->occupancy(used, capacity);
+}
+
+bool object_factory_t::stats(object_type_t type, object_stats_t& out) const
+{
+    if (!find_creator(type)) {
+        return false;
+    }
+    out = creator_[type].stats_;
+    return true;
+}
+
+object_handle_t object_factory_t::alloc_handle()
+{
+    uint32_t index = handle_free_;
+    const bool full = handle_.size() > object_handle_t::c_index_mask;
+    // grow the table while the queue is short, unless it is full
+    if (index == c_no_handle || (handle_free_count_ < c_min_free && !full)) {
+        if (full) {
+            // every index is taken, and none are free to reuse
+            return object_handle_t();
+        }
+        index = uint32_t(handle_.size());
+        handle_.push_back(handle_slot_t{ nullptr, 1, c_no_handle });
+    } else {
+        handle_free_ = handle_[index].next_;
+        if (handle_free_ == c_no_handle) {
+            handle_free_tail_ = c_no_handle;
+        }
+        --handle_free_count_;
+    }
+    // the caller fills in obj_ once the object is made
+    handle_slot_t& slot = handle_[index];
+    assert(!slot.obj_);
+    slot.next_ = c_no_handle;
+    return object_handle_t(index, slot.gen_);
+}
+
+void object_factory_t::free_handle(object_handle_t handle)
+{
+    handle_slot_t& slot = handle_[handle.index()];
+    assert(slot.gen_ == handle.gen());
+    slot.obj_ = nullptr;
+    slot.next_ = c_no_handle;
+    if (slot.gen_ == object_handle_t::c_gen_mask) {
+        // out of generations, wrapping would let old handles resolve again
+        return;
+    }
+    // bump the generation so outstanding handles go stale
+    ++slot.gen_;
+    // queue at the back so the slot is reused as late as possible
+    if (handle_free_tail_ == c_no_handle) {
+        handle_free_ = handle.index();
+    } else {
+        handle_[handle_free_tail_].next_ = handle.index();
+    }
+    handle_free_tail_ = handle.index();
+    ++handle_free_count_;
+}
+
+namespace {
+const uint32_t c_snapshot_magic = 0x534e4150;
+
+enum : uint32_t {
+    e_snap_alive = 1,
+    e_snap_staged = 2,
+};
+
+struct snapshot_slot_t {
+    uint32_t gen_;
+    uint32_t next_;
+    uint32_t occupied_;
+};
+
+struct snapshot_object_t {
+    uint32_t handle_;
+    object_type_t type_;
+    int32_t order_;
+    uint32_t size_;
+    uint32_t flags_;
+};
+} // namespace {}
+
+void object_factory_t::snapshot(snapshot_t& out) const
+{
+    out.clear();
+    out.write(c_snapshot_magic);
+    // handle table including the free list so that objects created after
+    // a restore are given the same handles as they were originally
+    out.write(uint32_t(handle_.size()));
+    out.write(handle_free_);
+    out.write(handle_free_tail_);
+    out.write(handle_free_count_);
+    for (const handle_slot_t& slot : handle_) {
+        out.write(snapshot_slot_t{ slot.gen_, slot.next_, slot.obj_ ? 1u : 0u });
+    }
+    const size_t count_pos = out.size();
+    out.alloc(sizeof(uint32_t));
+    uint32_t count = 0;
+    for (const object_t* obj : obj_) {
+        count += save_object(out, obj, false) ? 1 : 0;
+    }
+    for (const object_t* obj : stage_) {
+        count += save_object(out, obj, true) ? 1 : 0;
+    }
+    memcpy(out.data() + count_pos, &count, sizeof(count));
+}
+
+bool object_factory_t::save_object(snapshot_t& out,
+    const object_t* obj,
+    bool staged) const
+{
+    // orphans left by a previous restore() are not part of the world
+    if (!obj->handle_.valid()) {
+        return false;
+    }
+    // the header is filled in once we know the payload size
+    const size_t header = out.size();
+    out.alloc(sizeof(snapshot_object_t));
+    obj->save(out);
+    snapshot_object_t info;
+    info.handle_ = obj->handle_.value();
+    info.type_ = obj->type_;
+    info.order_ = obj->order_;
+    info.size_ = uint32_t(out.size() - header - sizeof(snapshot_object_t));
+    info.flags_ = (obj->alive_ ? e_snap_alive : 0u) | (staged ? e_snap_staged : 0u);
+    memcpy(out.data() + header, &info, sizeof(info));
+    return true;
+}
+
+bool object_factory_t::check_snapshot(const snapshot_t& in) const
+{
+    snapshot_reader_t reader(in);
+    uint32_t magic = 0, slots = 0, free = 0, free_tail = 0, free_count = 0;
+    if (!reader.read(magic) || magic != c_snapshot_magic) {
+        return false;
+    }
+    if (!reader.read(slots) || !reader.read(free) ||
+        !reader.read(free_tail) || !reader.read(free_count)) {
+        return false;
+    }
+    // free list links must stay inside the table
+    if (slots > object_handle_t::c_index_mask + 1) {
+        return false;
+    }
+    if ((free != c_no_handle && free >= slots) ||
+        (free_tail != c_no_handle && free_tail >= slots) || free_count > slots) {
+        return false;
+    }
+    std::vector<snapshot_slot_t> slot(slots);
+    uint32_t occupied = 0;
+    for (snapshot_slot_t& s : slot) {
+        if (!reader.read(s) || (s.next_ != c_no_handle && s.next_ >= slots)) {
+            return false;
         }
+        occupied += s.occupied_ ? 1 : 0;
+    }
+    // restore() keeps whatever holds an occupied slot, so each one needs
+    // exactly one record.  with records loading a slot at most once, the
+    // counts matching means every occupied slot is covered.
+    uint32_t count = 0;
+    if (!reader.read(count) || count != occupied) {
+        return false;
     }
-#if 1
-    // assert that orders are upheld
-    for (size_t i = 1; i < count; ++i) {
-        assert(!object_t::compare(obj_[i], obj_[i - 1]));
+    for (uint32_t i = 0; i < count; ++i) {
+        snapshot_object_t info;
+        if (!reader.read(info)) {
+            return false;
+        }
+        // every object must own its slot and be one this factory can make
+        const object_handle_t handle = object_handle_t::from_value(info.handle_);
+        const uint32_t index = handle.index();
+        if (index >= slots || !slot[index].occupied_ ||
+            slot[index].gen_ != handle.gen() || !find_creator(info.type_)) {
+            return false;
+        }
+        // an object kept across the restore must still be the same type
+        const object_t* kept = (index < handle_.size()) ? handle_[index].obj_ : nullptr;
+        if (kept && kept->handle_ == handle && kept->type_ != info.type_) {
+            return false;
+        }
+        // each slot is loaded once
+        slot[index].occupied_ = 0;
+        if (!reader.seek(reader.pos() + info.size_)) {
+            return false;
+        }
     }
-#endif
+    return true;
+}
+
+bool object_factory_t::restore(const snapshot_t& in)
+{
+    // check everything up front so a bad snapshot leaves the world as is
+    if (!check_snapshot(in)) {
+        return false;
+    }
+    snapshot_reader_t reader(in);
+    uint32_t magic = 0, slots = 0, free = 0, free_tail = 0, free_count = 0;
+    reader.read(magic);
+    reader.read(slots);
+    reader.read(free);
+    reader.read(free_tail);
+    reader.read(free_count);
+    const size_t table = reader.pos();
+    reader.seek(table + slots * sizeof(snapshot_slot_t));
+    // detach objects which did not exist when the snapshot was taken
+    auto detach = [&](object_t* obj) {
+        const object_handle_t h = obj->handle_;
+        if (h.valid()) {
+            snapshot_slot_t slot = { 0, 0, 0 };
+            if (h.index() < slots) {
+                memcpy(&slot, in.data() + table + h.index() * sizeof(slot),
+                    sizeof(slot));
+            }
+            if (slot.occupied_ && slot.gen_ == h.gen()) {
+                // same object as in the snapshot, it will be reused
+                return;
+            }
+            handle_[h.index()].obj_ = nullptr;
+            obj->handle_ = object_handle_t();
+            obj->destroy();
+        }
+        orphan_.push_back(obj);
+    };
+    for (object_t* obj : obj_) {
+        detach(obj);
+    }
+    for (object_t* obj : stage_) {
+        detach(obj);
+    }
+    obj_.clear();
+    stage_.clear();
+    // restore the handle table, kept objects are still in their slots
+    handle_.resize(slots, handle_slot_t{ nullptr, 1, c_no_handle });
+    for (uint32_t i = 0; i < slots; ++i) {
+        snapshot_slot_t slot;
+        memcpy(&slot, in.data() + table + i * sizeof(slot), sizeof(slot));
+        handle_[i].gen_ = slot.gen_;
+        handle_[i].next_ = slot.next_;
+        assert(slot.occupied_ || !handle_[i].obj_);
+    }
+    handle_free_ = free;
+    handle_free_tail_ = free_tail;
+    handle_free_count_ = free_count;
+    // recreate or reload every object
+    uint32_t count = 0;
+    reader.read(count);
+    obj_.reserve(count);
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < count; ++i) {
+        ok = load_object(reader) != nullptr;
+    }
+    assert(ok && "snapshot failed to load after being checked");
+    // orphans are dead and will be merged then collected as usual, which
+    // also holds if loading stopped short
+    stage_.insert(stage_.end(), orphan_.begin(), orphan_.end());
+    orphan_.clear();
+    return ok;
+}
+
+object_t* object_factory_t::load_object(snapshot_reader_t& in)
+{
+    snapshot_object_t info;
+    if (!in.read(info)) {
+        return nullptr;
+    }
+    const object_handle_t handle = object_handle_t::from_value(info.handle_);
+    if (handle.index() >= handle_.size()) {
+        return nullptr;
+    }
+    handle_slot_t& slot = handle_[handle.index()];
+    object_t* obj = slot.obj_;
+    if (!obj) {
+        // this object has been collected since, so make it again
+        creator_t* creator = find_creator(info.type_);
+        if (!creator) {
+            return nullptr;
+        }
+        obj = creator->create(info.type_, service_);
+        ++creator_[info.type_].stats_.created_;
+        obj->handle_ = handle;
+        slot.obj_ = obj;
+    }
+    assert(obj->type_ == info.type_);
+    obj->order_ = info.order_;
+    // bring the self reference in line with the saved alive state
+    const bool alive = (info.flags_ & e_snap_alive) != 0;
+    if (alive && !obj->alive_) {
+        obj->alive_ = true;
+        obj->ref_.inc();
+    } else if (!alive) {
+        obj->destroy();
+    }
+    const size_t start = in.pos();
+    obj->load(in);
+    assert(in.pos() == start + info.size_);
+    if (!in.seek(start + info.size_)) {
+        return nullptr;
+    }
+    ((info.flags_ & e_snap_staged) ? stage_ : obj_).push_back(obj);
+    return obj;
+}
+
+void object_factory_t::sort()
+{
+    TENGU_PROFILE_ZONE("objects.sort");
+    // the list is kept ordered as objects are staged so this only has
+    // work to do if an object has changed its order_ since then.
+    if (obj_.size() < 2 || is_ordered(obj_)) {
+        return;
+    }
+    radix_sort(obj_, scratch_);
+    assert(is_ordered(obj_));
+}
+
+void object_factory_t::merge_stage()
+{
+    // order the (usually small) staged list, then merge it into obj_ in
+    // a single linear pass.  ties favour obj_ so existing objects keep
+    // ticking ahead of new ones with the same order.
+    if (stage_.size() > 1 && !is_ordered(stage_)) {
+        radix_sort(stage_, scratch_);
+    }
+    if (obj_.empty() || !object_t::compare(stage_.front(), obj_.back())) {
+        // common case of everything landing at the end
+        obj_.insert(obj_.end(), stage_.begin(), stage_.end());
+    } else {
+        scratch_.resize(obj_.size() + stage_.size());
+        std::merge(obj_.begin(), obj_.end(),
+            stage_.begin(), stage_.end(),
+            scratch_.begin(), object_t::compare);
+        obj_.swap(scratch_);
+    }
+    stage_.clear();
 }
 
 void object_factory_t::collect()
 {
-    for (auto itt = obj_.begin(); itt != obj_.end();) {
+    TENGU_PROFILE_ZONE("objects.collect");
+    // compact the live objects to the front of obj_ in a single pass,
+    // which keeps their relative (tick) order intact.
+    size_t live = 0;
+    for (size_t i = 0; i < obj_.size(); ++i) {
         // deref to get our object
-        object_t* obj = *itt;
+        object_t* obj = obj_[i];
+        assert(obj);
         // check if this object is disposed
         if (obj->is_disposed()) {
-            // find the creator for this object
-            auto c_itt = creator_.find(obj->type_);
-            assert(c_itt != creator_.end());
-            // deref to get the creator object
-            const up_object_creator_t& creator = c_itt->second;
-            // use the creator to destroy this object
-            creator->destroy(obj);
-            // remove this object from the list
-            itt = obj_.erase(itt);
+            // a pending wake up has nothing left to wake
+            timers_.cancel(obj->wake_);
+            // objects orphaned by restore() no longer own a handle
+            if (obj->handle_.valid()) {
+                free_handle(obj->handle_);
+            }
+            dead_.push_back(obj);
         }
         // object has referenced then it is alive
         else {
-            ++itt;
+            obj_[live++] = obj;
+        }
+    }
+    obj_.resize(live);
+    if (dead_.empty()) {
+        return;
+    }
+    // group the dead by type so each creator is found once per collect
+    std::sort(dead_.begin(), dead_.end(),
+        [](const object_t* a, const object_t* b) {
+            return a->type_ < b->type_;
+        });
+    for (size_t i = 0; i < dead_.size();) {
+        const object_type_t type = dead_[i]->type_;
+        size_t j = i + 1;
+        while (j < dead_.size() && dead_[j]->type_ == type) {
+            ++j;
         }
+        // find the creator for this run of objects
+        creator_entry_t& entry = creator_[type];
+        assert(entry.creator_);
+        // use the creator to destroy this batch
+        entry.creator_->destroy_batch(&dead_[i], j - i);
+        entry.stats_.destroyed_ += uint32_t(j - i);
+        i = j;
     }
+    dead_.clear();
 }
 
 void object_factory_t::tick()
 {
-    // itterate over all active objects
-    for (auto itt = obj_.begin(); itt != obj_.end(); ++itt) {
-        // deref to get our object
-        object_t* obj = *itt;
-        assert(obj);
-        // check if this object is disposed
-        if (!obj->is_disposed() && obj->is_alive()) {
-            obj->tick();
-        }
+    TENGU_PROFILE_ZONE("objects.tick");
+    // wake objects due this tick before anything is ticked
+    timers_.advance();
+    if (jobs_) {
+        tick_parallel();
+    } else {
+        tick_serial();
     }
     // merge stage_ into obj_
     if (!stage_.empty()) {
-        obj_.reserve(obj_.size() + stage_.size());
-        obj_.insert(obj_.end(), stage_.begin(), stage_.end());
-        stage_.clear();
+        merge_stage();
+    }
+}
+
+void object_factory_t::tick_serial()
+{
+    if (!grouped_) {
+        // itterate over all active objects
+        for (auto itt = obj_.begin(); itt != obj_.end(); ++itt) {
+            // deref to get our object
+            object_t* obj = *itt;
+            assert(obj);
+            // check if this object is disposed
+            if (obj->is_alive() && !obj->is_sleeping()) {
+                obj->tick();
+            }
+        }
+        return;
+    }
+    for (size_t i = 0; i < obj_.size();) {
+        const size_t end = band_end(i);
+        group_band(i, end);
+        // dead and sleeping objects are skipped by tick_batch()
+        tick_run(&obj_[i], end - i);
+        i = end;
+    }
+}
+
+void object_factory_t::tick_parallel()
+{
+    assert(jobs_);
+    for (size_t i = 0; i < obj_.size();) {
+        const size_t end = band_end(i);
+        if (grouped_) {
+            group_band(i, end);
+        }
+        // split the live objects by thread safety
+        for (; i < end; ++i) {
+            object_t* obj = obj_[i];
+            assert(obj);
+            if (!obj->is_alive() || obj->is_sleeping()) {
+                continue;
+            }
+            (obj->is_thread_safe() ? band_ : serial_).push_back(obj);
+        }
+        // tick the thread safe part of the band across the pool
+        if (!band_.empty()) {
+            object_t* const* band = band_.data();
+            jobs_->parallel_for(band_.size(), grain_,
+                [this, band](size_t begin, size_t end) {
+                    tick_run(band + begin, end - begin);
+                });
+        }
+        // parallel_for acts as a barrier so the rest can run serially
+        tick_run(serial_.data(), serial_.size());
+        band_.clear();
+        serial_.clear();
+    }
+}
+
+void object_factory_t::sleep(object_t* obj, uint64_t ticks)
+{
+    assert(obj);
+    // objects ticking in parallel may put themselves to sleep
+    scope_lock_t<spinlock_t> guard(stage_lock_);
+    timers_.cancel(obj->wake_);
+    obj->sleeping_ = true;
+    // go through the handle so a wake up for a collected object is a no-op
+    const object_handle_t handle = obj->handle_;
+    obj->wake_ = timers_.schedule(ticks, [this, handle]() {
+        const uint32_t index = handle.index();
+        if (index < handle_.size() && handle_[index].gen_ == handle.gen()) {
+            if (object_t* sleeper = handle_[index].obj_) {
+                sleeper->sleeping_ = false;
+                sleeper->wake_ = timer_handle_t();
+            }
+        }
+    });
+}
+
+void object_factory_t::wake(object_t* obj)
+{
+    assert(obj);
+    scope_lock_t<spinlock_t> guard(stage_lock_);
+    timers_.cancel(obj->wake_);
+    obj->sleeping_ = false;
+    obj->wake_ = timer_handle_t();
+}
+
+size_t object_factory_t::band_end(size_t i) const
+{
+    // find the end of the run of objects sharing this order_ value
+    const size_t count = obj_.size();
+    const int32_t order = obj_[i]->order();
+    while (i < count && obj_[i]->order() == order) {
+        ++i;
+    }
+    return i;
+}
+
+void object_factory_t::group_band(size_t begin, size_t end)
+{
+    // order a band by type so each type forms one contiguous run.  this
+    // is done in obj_ itself so it sticks until new objects are merged.
+    auto by_type = [](const object_t* a, const object_t* b) {
+        return a->type_ < b->type_;
+    };
+    auto first = obj_.begin() + begin;
+    auto last = obj_.begin() + end;
+    if (!std::is_sorted(first, last, by_type)) {
+        std::stable_sort(first, last, by_type);
+    }
+}
+
+void object_factory_t::tick_run(object_t* const* obj, size_t count)
+{
+    if (!grouped_) {
+        for (size_t i = 0; i < count; ++i) {
+            if (obj[i]->is_alive() && !obj[i]->is_sleeping()) {
+                obj[i]->tick();
+            }
+        }
+        return;
+    }
+    // hand each run of a single type to its creator
+    for (size_t i = 0; i < count;) {
+        const object_type_t type = obj[i]->type_;
+        size_t j = i + 1;
+        while (j < count && obj[j]->type_ == type) {
+            ++j;
+        }
+        creator_t* creator = find_creator(type);
+        assert(creator);
+        creator->tick_batch(obj + i, j - i);
+        i = j;
     }
 }
 
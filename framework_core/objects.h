@@ -6,11 +6,19 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <new>
 #include <unordered_map>
 #include <vector>
 #include <string>
 
+#include "random.h"
+#include "snapshot.h"
+#include "symbol.h"
+#include "thread.h"
+#include "wheel.h"
+
 namespace tengu {
+struct job_pool_t;
 struct ref_t;
 struct object_t;
 struct object_ref_t;
@@ -18,6 +26,71 @@ struct object_ref_t;
 typedef uint32_t object_type_t;
 typedef void* object_service_t;
 
+// weak reference to an object made from a slot index and a generation.
+// handles are plain values so copying one touches no other memory, and
+// resolving a handle whose object has since been destroyed yields null.
+struct object_handle_t {
+
+    enum : uint32_t {
+        c_index_bits = 20,
+        c_index_mask = (1u << c_index_bits) - 1,
+        c_gen_mask = (1u << (32 - c_index_bits)) - 1
+    };
+
+    object_handle_t()
+        : value_(0)
+    {
+    }
+
+    object_handle_t(uint32_t index, uint32_t gen)
+        : value_((gen << c_index_bits) | (index & c_index_mask))
+    {
+        assert(index <= c_index_mask);
+        assert(gen <= c_gen_mask);
+    }
+
+    uint32_t index() const
+    {
+        return value_ & c_index_mask;
+    }
+
+    uint32_t gen() const
+    {
+        return value_ >> c_index_bits;
+    }
+
+    // generations start at one so a zero handle is never valid
+    bool valid() const
+    {
+        return value_ != 0;
+    }
+
+    uint32_t value() const
+    {
+        return value_;
+    }
+
+    static object_handle_t from_value(uint32_t value)
+    {
+        object_handle_t out;
+        out.value_ = value;
+        return out;
+    }
+
+    bool operator==(const object_handle_t& rhs) const
+    {
+        return value_ == rhs.value_;
+    }
+
+    bool operator!=(const object_handle_t& rhs) const
+    {
+        return value_ != rhs.value_;
+    }
+
+protected:
+    uint32_t value_;
+};
+
 struct ref_t {
     ref_t()
         : value_(0)
@@ -139,6 +212,8 @@ struct object_t {
         : type_(type)
         , alive_(true)
         , order_(0)
+        , thread_safe_(false)
+        , sleeping_(false)
     {
         // retain reference to self
         ref_.inc();
@@ -192,6 +267,12 @@ struct object_t {
 
     object_ref_t get_ref();
 
+    // handle assigned by the factory when this object was created
+    object_handle_t handle() const
+    {
+        return handle_;
+    }
+
     const object_type_t type_;
 
     uint32_t ref_count() const
@@ -206,6 +287,11 @@ struct object_t {
 
     virtual void tick(){};
 
+    // per type hooks to capture and restore state for a factory snapshot.
+    // load() must read back exactly what save() wrote.
+    virtual void save(snapshot_t&) const {};
+    virtual void load(snapshot_reader_t&) {};
+
     void destroy()
     {
         if (alive_) {
@@ -222,6 +308,24 @@ struct object_t {
         return alive_;
     }
 
+    int32_t order() const
+    {
+        return order_;
+    }
+
+    // true while object_factory_t::sleep() has this object out of the
+    // tick loop
+    bool is_sleeping() const
+    {
+        return sleeping_;
+    }
+
+    // true if this object can tick concurrently with others in its band
+    bool is_thread_safe() const
+    {
+        return thread_safe_;
+    }
+
     // std compare function for ordering
     static bool compare(const object_t* a, const object_t* b)
     {
@@ -231,33 +335,104 @@ struct object_t {
 
 protected:
     friend struct object_ref_t;
+    friend struct object_factory_t;
 
+    object_handle_t handle_;
     int32_t order_;
     ref_t ref_;
     bool alive_;
+
+    // set by objects whose tick() only touches their own state, the
+    // factory and refs they hold exclusively.  such objects may be
+    // ticked in parallel with the rest of their order_ band.
+    bool thread_safe_;
+
+    // skipped by the tick loop until wake_ fires
+    bool sleeping_;
+    timer_handle_t wake_;
+};
+
+// per type object counters, live is the number of objects created but
+// not yet collected.
+struct object_stats_t {
+    uint32_t created_;
+    uint32_t destroyed_;
+
+    uint32_t live() const
+    {
+        return created_ - destroyed_;
+    }
 };
 
 struct object_factory_t {
+    enum : uint32_t {
+        c_no_handle = 0xffffffffu,
+        // freed handle slots are queued and only reused once this many are
+        // waiting, so a slot's generation advances slowly even when objects
+        // are created and destroyed every frame
+        c_min_free = 1024,
+        // creators are held in a table indexed directly by type
+        c_max_types = 0x10000
+    };
+
     struct creator_t {
+        virtual ~creator_t()
+        {
+        }
+
         virtual object_t* create(object_type_t,
             object_service_t)
             = 0;
         virtual void destroy(object_t*) = 0;
+
+        // destroy a run of objects which are all of this creators type
+        virtual void destroy_batch(object_t* const* obj, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i) {
+                destroy(obj[i]);
+            }
+        }
+
+        // tick a run of live objects which are all of this creators type
+        virtual void tick_batch(object_t* const* obj, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i) {
+                if (obj[i]->is_alive() && !obj[i]->is_sleeping()) {
+                    obj[i]->tick();
+                }
+            }
+        }
+
+        // report how many objects are live and how many could be held
+        // without further allocation.  returns false if this creator
+        // does not pool its objects.
+        virtual bool occupancy(size_t&, size_t&) const
+        {
+            return false;
+        }
     };
 
     object_factory_t(object_service_t service)
-        : service_(service)
+        : handle_free_(c_no_handle)
+        , handle_free_tail_(c_no_handle)
+        , handle_free_count_(0)
+        , service_(service)
+        , jobs_(nullptr)
+        , grain_(64)
+        , grouped_(false)
+        , stage_lock_("object_factory.stage")
     {
     }
 
     template <typename type_t>
-    void add_creator()
+    bool add_creator()
     {
-        add_creator(type_t::type(), type_t::creator());
+        return add_creator(type_t::type(), type_t::creator());
     }
 
-    // creator pointer will transfer ownership
-    void add_creator(object_type_t type,
+    // creator pointer will transfer ownership.  returns false, and deletes
+    // the creator, if type is not below c_max_types.
+    bool add_creator(object_type_t type,
         creator_t* creator);
 
     template <typename type_t>
@@ -266,26 +441,139 @@ struct object_factory_t {
         return create(type_t::type());
     }
 
+    // returns an empty ref if type has no creator or every handle is
+    // in use
     object_ref_t create(object_type_t type);
 
     template <typename type_t, typename... args_t>
     object_ref_t create(args_t&&... args)
     {
         object_ref_t ref = create<type_t>();
-        ref->cast<type_t>().init(std::forward<args_t>(args)...);
+        if (ref.valid()) {
+            ref->cast<type_t>().init(std::forward<args_t>(args)...);
+        }
         return ref;
     };
 
+    // look up the object a handle refers to.  returns nullptr if the
+    // handle is stale or its object has been destroyed.  not safe to call
+    // from a parallel tick while other objects are being created.
+    object_t* resolve(object_handle_t handle) const
+    {
+        const uint32_t index = handle.index();
+        if (index >= handle_.size()) {
+            return nullptr;
+        }
+        const handle_slot_t& slot = handle_[index];
+        if (slot.gen_ != handle.gen() || !slot.obj_) {
+            return nullptr;
+        }
+        return slot.obj_->is_alive() ? slot.obj_ : nullptr;
+    }
+
+    template <typename type_t>
+    type_t* resolve(object_handle_t handle) const
+    {
+        object_t* obj = resolve(handle);
+        return (obj && obj->is_a<type_t>()) ? &obj->cast<type_t>() : nullptr;
+    }
+
     // prune any dead objects
     void collect();
 
-    // tick all objects
+    // serialize every object (live, dead and staged) and the handle
+    // table into snapshot.  any previous contents are discarded.
+    void snapshot(snapshot_t& out) const;
+
+    // roll back to the state captured in a snapshot.  objects created
+    // since are destroyed and detached from their handles, objects since
+    // collected are recreated under their original handle, then every
+    // object loads its saved state.  a snapshot which is truncated or does
+    // not match this factory is rejected before anything is changed.
+    bool restore(const snapshot_t& in);
+
+    // tick all objects, after advancing timers() by one tick
     void tick();
 
-    // sort all objects according to their sort order
+    // take an object out of the tick loop until 'ticks' factory ticks
+    // from now, when it is woken at the start of that tick.  sleeping
+    // again replaces any earlier wake up.  sleep state is not part of a
+    // snapshot.
+    void sleep(object_t* obj, uint64_t ticks);
+
+    // return a sleeping object to the tick loop right away
+    void wake(object_t* obj);
+
+    // timers counted in factory ticks, for delays which would otherwise
+    // be polled from an object's tick().  not safe to use from a
+    // parallel tick.
+    timer_wheel_t& timers()
+    {
+        return timers_;
+    }
+
+    // sort all objects according to their sort order.  staged objects are
+    // merged in order so this is only needed if an order_ has changed.
     void sort();
 
+    // tick thread safe objects across a job pool, one order_ band at a
+    // time.  pass nullptr to return to serial ticking.
+    void set_jobs(job_pool_t* jobs, size_t grain = 64)
+    {
+        jobs_ = jobs;
+        grain_ = grain;
+    }
+
+    // group each order_ band by type and tick every group through its
+    // creators tick_batch(), avoiding a virtual call per object.
+    void set_grouped(bool grouped)
+    {
+        grouped_ = grouped;
+    }
+
+    // query pool occupancy for a given object type
+    bool occupancy(object_type_t type, size_t& used, size_t& capacity) const;
+
+    // query the created/destroyed counters for a given object type
+    bool stats(object_type_t type, object_stats_t& out) const;
+
 protected:
+    creator_t* find_creator(object_type_t type) const
+    {
+        return (type < creator_.size()) ? creator_[type].creator_.get()
+                                        : nullptr;
+    }
+
+    object_ref_t create_(object_type_t type);
+    void tick_serial();
+    void tick_parallel();
+    void tick_run(object_t* const* obj, size_t count);
+    size_t band_end(size_t i) const;
+    void group_band(size_t begin, size_t end);
+    void merge_stage();
+
+    object_handle_t alloc_handle();
+    void free_handle(object_handle_t handle);
+    bool save_object(snapshot_t& out, const object_t* obj, bool staged) const;
+    object_t* load_object(snapshot_reader_t& in);
+    bool check_snapshot(const snapshot_t& in) const;
+
+    // handle table mapping a slot index to its object and generation.
+    // the table only ever grows so storage behind it (obj_, pools) can be
+    // compacted or recycled without invalidating outstanding handles.
+    // a slot whose generation is used up is retired rather than wrapped,
+    // so a stale handle can never come to resolve to a new object.
+    struct handle_slot_t {
+        object_t* obj_;
+        uint32_t gen_;
+        uint32_t next_;
+    };
+    std::vector<handle_slot_t> handle_;
+    // fifo of free slots, oldest first
+    uint32_t handle_free_;
+    uint32_t handle_free_tail_;
+    uint32_t handle_free_count_;
+
     // list of currently alive objects
     std::vector<object_t*> obj_;
 
@@ -293,13 +581,62 @@ protected:
     // beginning of factory tick this is merged into the obj_ list.
     std::vector<object_t*> stage_;
 
+    // scratch list of disposed objects gathered during collect()
+    std::vector<object_t*> dead_;
+
+    // scratch space for sorting and merging
+    std::vector<object_t*> scratch_;
+
+    // objects orphaned by restore() waiting to be collected
+    std::vector<object_t*> orphan_;
+
     typedef std::unique_ptr<creator_t> up_object_creator_t;
-    std::map<object_type_t, up_object_creator_t> creator_;
+    struct creator_entry_t {
+        creator_entry_t()
+            : stats_{ 0, 0 }
+        {
+        }
+
+        up_object_creator_t creator_;
+        object_stats_t stats_;
+    };
+    // creators and their counters indexed by object type
+    std::vector<creator_entry_t> creator_;
 
     // service object
     object_service_t service_;
+
+    // optional job pool for parallel ticking
+    job_pool_t* jobs_;
+    size_t grain_;
+
+    // tick objects in per type groups
+    bool grouped_;
+
+    // guards stage_ and the creators while ticking in parallel
+    spinlock_t stage_lock_;
+
+    // scratch lists used to split up an order_ band while ticking
+    std::vector<object_t*> band_;
+    std::vector<object_t*> serial_;
+
+    // wakes sleeping objects and runs timers(), advanced once per tick
+    timer_wheel_t timers_;
 };
 
+// tick a run of objects known to be exactly type_t.  the qualified call
+// is resolved statically so the loop has no virtual dispatch.
+template <typename type_t>
+void object_tick_batch(object_t* const* obj, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        type_t* ptr = static_cast<type_t*>(obj[i]);
+        if (ptr->is_alive() && !ptr->is_sleeping()) {
+            ptr->type_t::tick();
+        }
+    }
+}
+
 template <typename type_t>
 struct object_create_t : public object_factory_t::creator_t {
     virtual object_t* create(object_type_t, object_service_t service)
@@ -311,9 +648,129 @@ struct object_create_t : public object_factory_t::creator_t {
     {
         delete static_cast<type_t*>(obj);
     }
+
+    virtual void destroy_batch(object_t* const* obj, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            delete static_cast<type_t*>(obj[i]);
+        }
+    }
+
+    virtual void tick_batch(object_t* const* obj, size_t count)
+    {
+        object_tick_batch<type_t>(obj, count);
+    }
+};
+
+// pooled creator which allocates objects of a single type out of
+// contiguous slabs.  free slots are threaded into an intrusive free list
+// so creation and destruction are both O(1) and no heap traffic occurs
+// once the pool has grown to its working size.
+template <typename type_t, size_t slab_size = 256>
+struct object_pool_t : public object_factory_t::creator_t {
+
+    object_pool_t()
+        : free_(nullptr)
+        , used_(0)
+    {
+        static_assert(slab_size > 0, "slab_size must be non zero");
+    }
+
+    virtual object_t* create(object_type_t, object_service_t service)
+    {
+        if (!free_) {
+            grow();
+        }
+        assert(free_);
+        slot_t* slot = free_;
+        free_ = slot->next_;
+        ++used_;
+        return new (slot->data_) type_t(service);
+    }
+
+    virtual void destroy(object_t* obj)
+    {
+        assert(obj && used_);
+        type_t* ptr = static_cast<type_t*>(obj);
+        ptr->~type_t();
+        slot_t* slot = reinterpret_cast<slot_t*>(ptr);
+        assert(owns(slot));
+        slot->next_ = free_;
+        free_ = slot;
+        --used_;
+    }
+
+    virtual void destroy_batch(object_t* const* obj, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            object_pool_t::destroy(obj[i]);
+        }
+    }
+
+    virtual void tick_batch(object_t* const* obj, size_t count)
+    {
+        object_tick_batch<type_t>(obj, count);
+    }
+
+    virtual bool occupancy(size_t& used_out, size_t& capacity_out) const
+    {
+        used_out = used();
+        capacity_out = capacity();
+        return true;
+    }
+
+    size_t used() const
+    {
+        return used_;
+    }
+
+    size_t capacity() const
+    {
+        return slab_.size() * slab_size;
+    }
+
+    size_t slabs() const
+    {
+        return slab_.size();
+    }
+
+protected:
+    union slot_t {
+        slot_t* next_;
+        alignas(type_t) uint8_t data_[sizeof(type_t)];
+    };
+
+    typedef std::unique_ptr<slot_t[]> slab_t;
+
+    void grow()
+    {
+        slab_t slab(new slot_t[slab_size]);
+        slot_t* base = slab.get();
+        // thread the new slots onto the free list in address order
+        for (size_t i = 0; i < slab_size; ++i) {
+            base[i].next_ = (i + 1 < slab_size) ? &base[i + 1] : free_;
+        }
+        free_ = base;
+        slab_.push_back(std::move(slab));
+    }
+
+    bool owns(const slot_t* slot) const
+    {
+        for (const slab_t& slab : slab_) {
+            if (slot >= slab.get() && slot < slab.get() + slab_size) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<slab_t> slab_;
+    slot_t* free_;
+    size_t used_;
 };
 
-template <object_type_t id_t, typename type_t>
+template <object_type_t id_t, typename type_t,
+    typename create_t = object_create_t<type_t> >
 struct object_ex_t : public object_t {
     object_ex_t()
         : object_t(type())
@@ -327,47 +784,178 @@ struct object_ex_t : public object_t {
 
     static object_factory_t::creator_t* creator()
     {
-        return new object_create_t<type_t>();
+        return new create_t();
     }
 };
 
+// map of named objects.  names are interned to symbols and the objects
+// are held in an open addressed table keyed by symbol, so a lookup by
+// symbol is a single probe in the common case and never allocates.
 struct object_map_t {
 
     object_map_t()
-        : map_()
+        : size_(0)
+        , used_(0)
     {
     }
 
-    bool contains(const std::string & key) const
+    bool contains(symbol_t key) const
     {
-        auto itt = map_.find(key);
-        return itt != map_.end();
+        return find(key) != c_none;
     }
 
-    void insert(const std::string & key, object_ref_t obj)
+    bool contains(const char* key) const
     {
-        map_[key] = obj;
+        return contains(symbol_table_t::inst().find(key));
     }
 
-    void remove(const std::string & key)
+    bool contains(const std::string& key) const
     {
-        auto itt = map_.find(key);
-        if (itt != map_.end()) {
-            map_.erase(itt);
+        return contains(key.c_str());
+    }
+
+    void insert(symbol_t key, object_ref_t obj)
+    {
+        assert(key != c_no_symbol);
+        size_t index = find(key);
+        if (index == c_none) {
+            // keep the table at most half full, tombstones included
+            if ((used_ + 1) * 2 > slot_.size()) {
+                rehash();
+            }
+            index = probe_free(key);
+            if (slot_[index].key_ == c_no_symbol) {
+                ++used_;
+            }
+            slot_[index].key_ = key;
+            ++size_;
         }
+        slot_[index].value_ = obj;
+    }
+
+    void insert(const char* key, object_ref_t obj)
+    {
+        insert(intern(key), obj);
     }
 
-    object_ref_t operator[](const std::string & key)
+    void insert(const std::string& key, object_ref_t obj)
     {
-        typename map_t::iterator itt = map_.find(key);
-        assert(itt != map_.end());
-        return itt->second;
+        insert(key.c_str(), obj);
+    }
+
+    void remove(symbol_t key)
+    {
+        const size_t index = find(key);
+        if (index != c_none) {
+            slot_[index].key_ = c_tombstone;
+            slot_[index].value_.dispose();
+            --size_;
+        }
+    }
+
+    void remove(const char* key)
+    {
+        remove(symbol_table_t::inst().find(key));
+    }
+
+    void remove(const std::string& key)
+    {
+        remove(key.c_str());
+    }
+
+    object_ref_t operator[](symbol_t key)
+    {
+        const size_t index = find(key);
+        assert(index != c_none);
+        return slot_[index].value_;
+    }
+
+    object_ref_t operator[](const char* key)
+    {
+        return operator[](symbol_table_t::inst().find(key));
+    }
+
+    object_ref_t operator[](const std::string& key)
+    {
+        return operator[](key.c_str());
+    }
+
+    size_t size() const
+    {
+        return size_;
     }
 
 protected:
-    typedef std::unordered_map<
-        std::string,
-        object_ref_t> map_t;
-    map_t map_;
+    enum : symbol_t {
+        c_tombstone = 0xffffffffu
+    };
+
+    enum : size_t {
+        c_none = ~size_t(0)
+    };
+
+    struct slot_t {
+        slot_t()
+            : key_(c_no_symbol)
+        {
+        }
+
+        symbol_t key_;
+        object_ref_t value_;
+    };
+
+    size_t find(symbol_t key) const
+    {
+        if (slot_.empty() || key == c_no_symbol) {
+            return c_none;
+        }
+        const size_t mask = slot_.size() - 1;
+        for (size_t i = hash_t::wang_32(key) & mask;; i = (i + 1) & mask) {
+            const symbol_t k = slot_[i].key_;
+            if (k == key) {
+                return i;
+            }
+            if (k == c_no_symbol) {
+                return c_none;
+            }
+        }
+    }
+
+    // first empty or tombstoned slot along the probe sequence for key
+    size_t probe_free(symbol_t key) const
+    {
+        const size_t mask = slot_.size() - 1;
+        size_t i = hash_t::wang_32(key) & mask;
+        while (slot_[i].key_ != c_no_symbol && slot_[i].key_ != c_tombstone) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void rehash()
+    {
+        // grow if live entries need the space, else just drop tombstones
+        size_t capacity = slot_.empty() ? 16 : slot_.size();
+        if ((size_ + 1) * 4 > capacity) {
+            capacity *= 2;
+        }
+        std::vector<slot_t> old;
+        old.swap(slot_);
+        slot_.resize(capacity);
+        used_ = size_;
+        for (slot_t& s : old) {
+            if (s.key_ != c_no_symbol && s.key_ != c_tombstone) {
+                const size_t i = probe_free(s.key_);
+                slot_[i].key_ = s.key_;
+                slot_[i].value_ = std::move(s.value_);
+            }
+        }
+    }
+
+    std::vector<slot_t> slot_;
+    // live entries
+    size_t size_;
+    // live entries plus tombstones
+    size_t used_;
 };
 } // namespace tengu
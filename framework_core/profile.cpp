@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+#include "profile.h"
+
+namespace tengu {
+
+namespace {
+thread_local profile_thread_t* tls_profile = nullptr;
+
+uint64_t now_ns()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// json string body, names are expected to be plain identifiers but
+// quotes and backslashes are escaped all the same
+void append_escaped(std::string& out, const char* str)
+{
+    for (; *str; ++str) {
+        const char ch = *str;
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+        }
+        if (uint8_t(ch) >= 0x20) {
+            out += ch;
+        }
+    }
+}
+} // namespace {}
+
+uint64_t profile_thread_t::copy(uint64_t from,
+    std::vector<profile_event_t>& out) const
+{
+    // the owner writes slot 'head' before publishing it, and that slot is
+    // also where event 'head - c_capacity' lived, so it is not readable
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    if (head >= c_capacity && from <= head - c_capacity) {
+        from = head - c_capacity + 1;
+    }
+    const size_t start = out.size();
+    for (uint64_t i = from; i < head; ++i) {
+        out.push_back(event_[i & (c_capacity - 1)]);
+    }
+    // the owner may have lapped us while copying, drop anything which
+    // could have been overwritten
+    const uint64_t after = head_.load(std::memory_order_acquire);
+    if (after >= c_capacity && from <= after - c_capacity) {
+        const size_t lost = size_t(after - c_capacity + 1 - from);
+        out.erase(out.begin() + start,
+            out.begin() + start + std::min(lost, out.size() - start));
+    }
+    return head;
+}
+
+profile_thread_t& profile_local()
+{
+    if (!tls_profile) {
+        tls_profile = profiler_t::inst().add_thread();
+    }
+    return *tls_profile;
+}
+
+void profile_thread(const char* name)
+{
+    profiler_t::inst().name_thread(profile_local(), name);
+}
+
+profiler_t::profiler_t()
+    : frame_begin_(profile_now())
+    , frame_ticks_(0)
+    , base_ticks_(profile_now())
+    , base_ns_(now_ns())
+{
+}
+
+profiler_t& profiler_t::inst()
+{
+    // leaked so threads can still record during static destruction
+    static profiler_t* profiler = new profiler_t;
+    return *profiler;
+}
+
+profile_thread_t* profiler_t::add_thread()
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    // buffers outlive their threads so their events can still be exported
+    thread_.emplace_back(new profile_thread_t(uint32_t(thread_.size())));
+    return thread_.back().get();
+}
+
+void profiler_t::name_thread(profile_thread_t& thread, const char* name)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    thread.name_ = name;
+}
+
+double profiler_t::ticks_per_us() const
+{
+    // calibrate against steady_clock over the whole run so far
+    const uint64_t ns = now_ns() - base_ns_;
+    const uint64_t ticks = profile_now() - base_ticks_;
+    if (ns < 1000 || ticks == 0) {
+        return 1000.0;
+    }
+    return double(ticks) * 1000.0 / double(ns);
+}
+
+void profiler_t::frame()
+{
+    const uint64_t now = profile_now();
+    const double ms_per_tick = 1.0 / (ticks_per_us() * 1000.0);
+    std::vector<profile_event_t> events;
+    std::vector<profile_stat_t> stats;
+
+    std::lock_guard<std::mutex> guard(lock_);
+    for (auto& t : thread_) {
+        events.clear();
+        t->read_ = t->copy(std::max(t->read_, t->first_), events);
+        for (const profile_event_t& e : events) {
+            // merge with an earlier entry of the same name on this thread
+            profile_stat_t* stat = nullptr;
+            for (size_t i = 0; i < stats.size(); ++i) {
+                profile_stat_t& s = stats[i];
+                if (s.thread_ == t->id_ && s.type_ == e.type_ &&
+                    (s.name_ == e.name_ || strcmp(s.name_, e.name_) == 0)) {
+                    stat = &s;
+                    break;
+                }
+            }
+            if (!stat) {
+                stats.push_back(profile_stat_t{
+                    e.name_, t->id_, e.type_, e.depth_, 0, 0.0 });
+                stat = &stats.back();
+            }
+            ++stat->count_;
+            if (e.type_ == e_profile_zone) {
+                stat->value_ += double(e.end_ - e.begin_) * ms_per_tick;
+            } else {
+                memcpy(&stat->value_, &e.end_, sizeof(stat->value_));
+            }
+        }
+    }
+    stats_.swap(stats);
+    frame_ticks_ = now - frame_begin_;
+    frame_begin_ = now;
+}
+
+void profiler_t::stats(std::vector<profile_stat_t>& out) const
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    out = stats_;
+}
+
+double profiler_t::frame_ms() const
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    return double(frame_ticks_) / (ticks_per_us() * 1000.0);
+}
+
+void profiler_t::export_trace(std::string& out) const
+{
+    const double tick_us = ticks_per_us();
+    std::vector<profile_event_t> events;
+    std::array<char, 256> temp;
+
+    std::lock_guard<std::mutex> guard(lock_);
+    out = "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& t : thread_) {
+        if (!t->name_.empty()) {
+            snprintf(temp.data(), temp.size(),
+                "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\","
+                "\"args\":{\"name\":\"",
+                first ? "" : ",\n", t->id_);
+            out += temp.data();
+            append_escaped(out, t->name_.c_str());
+            out += "\"}}";
+            first = false;
+        }
+        events.clear();
+        t->copy(t->first_, events);
+        for (const profile_event_t& e : events) {
+            out += first ? "" : ",\n";
+            first = false;
+            out += "{\"name\":\"";
+            append_escaped(out, e.name_);
+            const double ts = double(e.begin_ - base_ticks_) / tick_us;
+            if (e.type_ == e_profile_zone) {
+                // complete events carry their own duration
+                snprintf(temp.data(), temp.size(),
+                    "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    t->id_, ts, double(e.end_ - e.begin_) / tick_us);
+            } else {
+                double value = 0.0;
+                memcpy(&value, &e.end_, sizeof(value));
+                snprintf(temp.data(), temp.size(),
+                    "\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+                    "\"args\":{\"value\":%g}}",
+                    t->id_, ts, value);
+            }
+            out += temp.data();
+        }
+    }
+    out += "\n]}\n";
+}
+
+bool profiler_t::export_trace(const char* path) const
+{
+    std::string json;
+    export_trace(json);
+    FILE* fd = fopen(path, "wb");
+    if (!fd) {
+        return false;
+    }
+    const bool ok = fwrite(json.data(), 1, json.size(), fd) == json.size();
+    fclose(fd);
+    return ok;
+}
+
+void profiler_t::clear()
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    for (auto& t : thread_) {
+        t->first_ = t->head_.load(std::memory_order_acquire);
+        t->read_ = t->first_;
+    }
+    stats_.clear();
+    frame_begin_ = profile_now();
+    frame_ticks_ = 0;
+}
+
+} // namespace tengu
@@ -0,0 +1,217 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// instrumentation macros.  these compile to nothing unless TENGU_PROFILE
+// is defined, so hot paths can be left instrumented.  names must be string
+// literals (or otherwise outlive the profiler) as only the pointer is kept.
+#if defined(TENGU_PROFILE)
+#define TENGU_PROFILE_CAT_(a, b) a##b
+#define TENGU_PROFILE_CAT(a, b) TENGU_PROFILE_CAT_(a, b)
+// time the enclosing scope
+#define TENGU_PROFILE_ZONE(name) \
+    tengu::profile_zone_t TENGU_PROFILE_CAT(profile_zone_, __LINE__)(name)
+// record the value of a counter
+#define TENGU_PROFILE_COUNTER(name, value) \
+    tengu::profile_counter(name, double(value))
+// mark the end of a frame, call once per frame from the main thread
+#define TENGU_PROFILE_FRAME() tengu::profiler_t::inst().frame()
+// name the calling thread in traces and the overlay
+#define TENGU_PROFILE_THREAD(name) tengu::profile_thread(name)
+#else
+#define TENGU_PROFILE_ZONE(name) ((void)0)
+// sizeof keeps 'value' used without evaluating it
+#define TENGU_PROFILE_COUNTER(name, value) ((void)sizeof(value))
+#define TENGU_PROFILE_FRAME() ((void)0)
+#define TENGU_PROFILE_THREAD(name) ((void)0)
+#endif
+
+namespace tengu {
+
+enum profile_type_t : uint32_t {
+    e_profile_zone,
+    e_profile_counter,
+};
+
+struct profile_event_t {
+    const char* name_;
+    // timestamps in profile_now() ticks
+    uint64_t begin_;
+    // end of a zone, or the bits of a counter's value
+    uint64_t end_;
+    uint32_t depth_;
+    profile_type_t type_;
+};
+
+// events recorded by one thread.  only the owning thread writes, so
+// recording is a handful of stores.  once full the oldest events are
+// overwritten.
+struct profile_thread_t {
+
+    enum : uint64_t {
+        c_capacity = 1 << 15,
+    };
+
+    profile_thread_t(uint32_t id)
+        : head_(0)
+        , read_(0)
+        , first_(0)
+        , depth_(0)
+        , id_(id)
+    {
+    }
+
+    profile_event_t& next()
+    {
+        return event_[head_.load(std::memory_order_relaxed) & (c_capacity - 1)];
+    }
+
+    void commit()
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
+    }
+
+    // copy out events with index >= 'from' which have not been overwritten,
+    // returns the index to continue from next time
+    uint64_t copy(uint64_t from, std::vector<profile_event_t>& out) const;
+
+    std::atomic<uint64_t> head_;
+    // next event for profiler_t::frame() to look at
+    uint64_t read_;
+    // events before this were thrown away by profiler_t::clear()
+    uint64_t first_;
+    uint32_t depth_;
+    uint32_t id_;
+    // set under the profiler lock
+    std::string name_;
+    profile_event_t event_[c_capacity];
+};
+
+// per frame totals shown by the overlay
+struct profile_stat_t {
+    const char* name_;
+    uint32_t thread_;
+    profile_type_t type_;
+    uint32_t depth_;
+    uint32_t count_;
+    // milliseconds spent in a zone, or the last value of a counter
+    double value_;
+};
+
+// current time in profiler ticks.  uses the cpu timestamp counter where
+// available as it is far cheaper to read than steady_clock.
+inline uint64_t profile_now()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__i386__) || defined(__x86_64__)
+    return __builtin_ia32_rdtsc();
+#else
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// the calling thread's event buffer, created on first use
+profile_thread_t& profile_local();
+
+void profile_thread(const char* name);
+
+inline void profile_counter(const char* name, double value)
+{
+    profile_thread_t& t = profile_local();
+    profile_event_t& e = t.next();
+    e.name_ = name;
+    e.begin_ = profile_now();
+    static_assert(sizeof(value) == sizeof(e.end_), "");
+    memcpy(&e.end_, &value, sizeof(value));
+    e.depth_ = t.depth_;
+    e.type_ = e_profile_counter;
+    t.commit();
+}
+
+// times its own lifetime
+struct profile_zone_t {
+
+    explicit profile_zone_t(const char* name)
+        : thread_(profile_local())
+        , name_(name)
+        , begin_(profile_now())
+    {
+        ++thread_.depth_;
+    }
+
+    profile_zone_t(const profile_zone_t&) = delete;
+    void operator=(const profile_zone_t&) = delete;
+
+    ~profile_zone_t()
+    {
+        const uint64_t end = profile_now();
+        --thread_.depth_;
+        profile_event_t& e = thread_.next();
+        e.name_ = name_;
+        e.begin_ = begin_;
+        e.end_ = end;
+        e.depth_ = thread_.depth_;
+        e.type_ = e_profile_zone;
+        thread_.commit();
+    }
+
+protected:
+    profile_thread_t& thread_;
+    const char* name_;
+    uint64_t begin_;
+};
+
+struct profiler_t {
+
+    static profiler_t& inst();
+
+    // gather the events recorded since the last frame into stats()
+    void frame();
+
+    // totals for the last frame, zones in the order they finished
+    void stats(std::vector<profile_stat_t>& out) const;
+
+    // duration of the last frame in milliseconds
+    double frame_ms() const;
+
+    // write every buffered event as chrome trace_event json, which can
+    // be loaded in chrome://tracing or perfetto
+    bool export_trace(const char* path) const;
+    void export_trace(std::string& out) const;
+
+    // forget everything recorded so far
+    void clear();
+
+    // add a thread's buffer, done by profile_local()
+    profile_thread_t* add_thread();
+    void name_thread(profile_thread_t& thread, const char* name);
+
+    // profiler ticks per microsecond
+    double ticks_per_us() const;
+
+protected:
+    profiler_t();
+
+    mutable std::mutex lock_;
+    std::vector<std::unique_ptr<profile_thread_t>> thread_;
+    std::vector<profile_stat_t> stats_;
+    uint64_t frame_begin_;
+    uint64_t frame_ticks_;
+    // calibration of profile_now() against steady_clock
+    uint64_t base_ticks_;
+    uint64_t base_ns_;
+};
+
+} // namespace tengu
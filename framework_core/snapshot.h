@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace tengu {
+
+// linear arena that object state is serialized into.  the arena keeps its
+// storage between uses, so once it has grown to the working size taking a
+// snapshot performs no allocation.
+struct snapshot_t {
+
+    explicit snapshot_t(size_t reserve = 0)
+        : size_(0)
+        , capacity_(0)
+    {
+        if (reserve) {
+            grow(reserve);
+        }
+    }
+
+    snapshot_t(const snapshot_t&) = delete;
+    void operator=(const snapshot_t&) = delete;
+
+    // reset the write position keeping the storage
+    void clear()
+    {
+        size_ = 0;
+    }
+
+    // write raw data
+    bool write(const void* src, size_t size)
+    {
+        uint8_t* dst = alloc(size);
+        memcpy(dst, src, size);
+        return true;
+    }
+
+    // write specific type
+    template <typename type_t>
+    bool write(const type_t& in)
+    {
+        return write(&in, sizeof(type_t));
+    }
+
+    // reserve space to be filled in later
+    uint8_t* alloc(size_t size)
+    {
+        if (size_ + size > capacity_) {
+            grow(size_ + size);
+        }
+        uint8_t* out = data_.get() + size_;
+        size_ += size;
+        return out;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+    const uint8_t* data() const
+    {
+        return data_.get();
+    }
+
+    uint8_t* data()
+    {
+        return data_.get();
+    }
+
+protected:
+    void grow(size_t need)
+    {
+        size_t capacity = capacity_ ? capacity_ : 1024;
+        while (capacity < need) {
+            capacity *= 2;
+        }
+        std::unique_ptr<uint8_t[]> mem(new uint8_t[capacity]);
+        if (size_) {
+            memcpy(mem.get(), data_.get(), size_);
+        }
+        data_.reset(mem.release());
+        capacity_ = capacity;
+    }
+
+    size_t size_;
+    size_t capacity_;
+    std::unique_ptr<uint8_t[]> data_;
+};
+
+// reads back data written into a snapshot_t
+struct snapshot_reader_t {
+
+    explicit snapshot_reader_t(const snapshot_t& snap)
+        : data_(snap.data())
+        , size_(snap.size())
+        , pos_(0)
+    {
+    }
+
+    // read raw data
+    bool read(void* dst, size_t size)
+    {
+        if (pos_ + size > size_) {
+            return false;
+        }
+        memcpy(dst, data_ + pos_, size);
+        pos_ += size;
+        return true;
+    }
+
+    // read specific type
+    template <typename type_t>
+    bool read(type_t& out)
+    {
+        return read(&out, sizeof(type_t));
+    }
+
+    // current read position
+    size_t pos() const
+    {
+        return pos_;
+    }
+
+    // seek to specific read position
+    bool seek(size_t pos)
+    {
+        if (pos > size_) {
+            return false;
+        }
+        pos_ = pos;
+        return true;
+    }
+
+    bool eof() const
+    {
+        return pos_ >= size_;
+    }
+
+protected:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+};
+
+} // namespace tengu
@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace tengu {
+
+// fixed capacity single producer, single consumer ring.  push and pop are
+// wait free, so a real time consumer such as the audio callback can never
+// be held up by the producer.  one thread may push and one other thread
+// may pop, any more than that needs a different queue.
+template <typename type_t, size_t c_capacity>
+struct spsc_ring_t {
+
+    static_assert(c_capacity && (c_capacity & (c_capacity - 1)) == 0,
+        "capacity must be a power of two");
+
+    spsc_ring_t()
+        : head_(0)
+        , tail_cache_(0)
+        , tail_(0)
+        , head_cache_(0)
+    {
+    }
+
+    spsc_ring_t(const spsc_ring_t&) = delete;
+    void operator=(const spsc_ring_t&) = delete;
+
+    // producer only, returns false if the ring is full
+    bool push(const type_t& in)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ == c_capacity) {
+            // only look at the consumers index when our copy says full
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == c_capacity) {
+                return false;
+            }
+        }
+        slot_[tail & (c_capacity - 1)] = in;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only, returns false if the ring is empty
+    bool pop(type_t& out)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) {
+                return false;
+            }
+        }
+        out = slot_[head & (c_capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // only exact when neither side is running
+    size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) -
+            head_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    static size_t capacity()
+    {
+        return c_capacity;
+    }
+
+protected:
+    // written by the consumer, with its copy of the producers index
+    std::atomic<size_t> head_;
+    size_t tail_cache_;
+    uint8_t pad0_[64];
+    // written by the producer, with its copy of the consumers index
+    std::atomic<size_t> tail_;
+    size_t head_cache_;
+    uint8_t pad1_[64];
+    type_t slot_[c_capacity];
+};
+
+} // namespace tengu
@@ -0,0 +1,122 @@
+#include "symbol.h"
+#include "random.h"
+
+#include <cstring>
+
+namespace tengu {
+namespace {
+const size_t c_chunk_size = 4096;
+const size_t c_table_size = 256;
+
+// string_1 hash that also measures the string
+uint32_t hash_string(const char* str, uint32_t& size)
+{
+    size = uint32_t(strlen(str));
+    return hash_t::string_1(str);
+}
+} // namespace {}
+
+symbol_table_t::symbol_table_t()
+    : chunk_used_(0)
+    , chunk_size_(0)
+    , lock_("symbol_table")
+{
+    // reserve symbol zero so it is never handed out
+    entry_.push_back(entry_t{ 0, 0, "" });
+    table_.resize(c_table_size, c_no_symbol);
+}
+
+symbol_table_t& symbol_table_t::inst()
+{
+    // made on first use, which c++11 makes thread safe, and leaked so
+    // symbols can still be interned during static destruction
+    static symbol_table_t* inst_ = new symbol_table_t;
+    return *inst_;
+}
+
+symbol_t symbol_table_t::intern(const char* str)
+{
+    assert(str);
+    uint32_t size = 0;
+    const uint32_t hash = hash_string(str, size);
+    scope_lock_t<spinlock_t> guard(lock_);
+    symbol_t sym = find_(str, hash, size);
+    if (sym != c_no_symbol) {
+        return sym;
+    }
+    // keep the table at most half full
+    if ((entry_.size() + 1) * 2 > table_.size()) {
+        grow();
+    }
+    sym = symbol_t(entry_.size());
+    entry_.push_back(entry_t{ hash, size, store(str, size) });
+    insert_slot(sym);
+    return sym;
+}
+
+symbol_t symbol_table_t::find(const char* str) const
+{
+    assert(str);
+    uint32_t size = 0;
+    const uint32_t hash = hash_string(str, size);
+    scope_lock_t<spinlock_t> guard(lock_);
+    return find_(str, hash, size);
+}
+
+const char* symbol_table_t::name(symbol_t sym) const
+{
+    scope_lock_t<spinlock_t> guard(lock_);
+    assert(sym < entry_.size());
+    return (sym < entry_.size()) ? entry_[sym].str_ : "";
+}
+
+symbol_t symbol_table_t::find_(const char* str,
+    uint32_t hash,
+    uint32_t size) const
+{
+    const size_t mask = table_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const symbol_t sym = table_[i];
+        if (sym == c_no_symbol) {
+            return c_no_symbol;
+        }
+        const entry_t& e = entry_[sym];
+        if (e.hash_ == hash && e.size_ == size && memcmp(e.str_, str, size) == 0) {
+            return sym;
+        }
+    }
+}
+
+void symbol_table_t::insert_slot(symbol_t sym)
+{
+    const size_t mask = table_.size() - 1;
+    size_t i = entry_[sym].hash_ & mask;
+    while (table_[i] != c_no_symbol) {
+        i = (i + 1) & mask;
+    }
+    table_[i] = sym;
+}
+
+void symbol_table_t::grow()
+{
+    table_.assign(table_.size() * 2, c_no_symbol);
+    for (symbol_t sym = 1; sym < entry_.size(); ++sym) {
+        insert_slot(sym);
+    }
+}
+
+const char* symbol_table_t::store(const char* str, uint32_t size)
+{
+    const size_t need = size + 1;
+    if (chunk_used_ + need > chunk_size_) {
+        chunk_size_ = (need > c_chunk_size) ? need : c_chunk_size;
+        chunk_.emplace_back(new char[chunk_size_]);
+        chunk_used_ = 0;
+    }
+    char* out = chunk_.back().get() + chunk_used_;
+    memcpy(out, str, need);
+    chunk_used_ += need;
+    return out;
+}
+
+} // namespace tengu
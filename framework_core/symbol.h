@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "thread.h"
+
+namespace tengu {
+
+// interned string identifier.  equal strings always map to the same
+// symbol and symbols are never reused, so they can be compared, hashed
+// and stored in place of the strings themselves.
+typedef uint32_t symbol_t;
+
+enum : symbol_t {
+    c_no_symbol = 0
+};
+
+struct symbol_table_t {
+
+    symbol_table_t();
+
+    // return the symbol for str, adding it if it is new
+    symbol_t intern(const char* str);
+
+    symbol_t intern(const std::string& str)
+    {
+        return intern(str.c_str());
+    }
+
+    // return the symbol for str or c_no_symbol if it was never interned
+    symbol_t find(const char* str) const;
+
+    symbol_t find(const std::string& str) const
+    {
+        return find(str.c_str());
+    }
+
+    // return the string a symbol was interned from
+    const char* name(symbol_t sym) const;
+
+    size_t size() const
+    {
+        return entry_.size() - 1;
+    }
+
+    // global table shared by the engine
+    static symbol_table_t& inst();
+
+protected:
+    struct entry_t {
+        uint32_t hash_;
+        uint32_t size_;
+        const char* str_;
+    };
+
+    symbol_t find_(const char* str, uint32_t hash, uint32_t size) const;
+    void insert_slot(symbol_t sym);
+    void grow();
+    const char* store(const char* str, uint32_t size);
+
+    // symbol -> string, index zero is reserved for c_no_symbol
+    std::vector<entry_t> entry_;
+    // open addressed table of symbols keyed by string hash
+    std::vector<symbol_t> table_;
+    // string storage in fixed size chunks so names never move
+    std::vector<std::unique_ptr<char[]> > chunk_;
+    size_t chunk_used_;
+    size_t chunk_size_;
+
+    mutable spinlock_t lock_;
+};
+
+// intern into the global symbol table
+inline symbol_t intern(const char* str)
+{
+    return symbol_table_t::inst().intern(str);
+}
+
+inline symbol_t intern(const std::string& str)
+{
+    return symbol_table_t::inst().intern(str);
+}
+
+} // namespace tengu
@@ -1,9 +1,242 @@
 #include "thread.h"
 #include <thread>
+#if defined(TENGU_LOCK_STATS)
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#endif
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_MSC_VER)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
 
 namespace tengu {
 void yield()
 {
     std::this_thread::yield();
 }
+
+namespace {
+enum : uint32_t {
+    // nested mcs locks a thread can hold through lock()
+    c_mcs_depth = 16,
+    // pause iterations before a futex lock goes to sleep
+    c_futex_spin = 128,
+};
+
+thread_local mcs_lock_t::node_t tls_mcs_node[c_mcs_depth];
+thread_local uint32_t tls_mcs_depth = 0;
+
+// block while *addr == value, may return spuriously
+void futex_wait(std::atomic<uint32_t>* addr, uint32_t value)
+{
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr),
+        FUTEX_WAIT_PRIVATE, value, nullptr, nullptr, 0);
+#elif defined(_MSC_VER)
+    WaitOnAddress(addr, &value, sizeof(value), INFINITE);
+#else
+    // no kernel wait available, fall back to giving up the time slice
+    (void)addr;
+    (void)value;
+    yield();
+#endif
+}
+
+void futex_wake_one(std::atomic<uint32_t>* addr)
+{
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr),
+        FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#elif defined(_MSC_VER)
+    WakeByAddressSingle(addr);
+#else
+    (void)addr;
+#endif
+}
+} // namespace {}
+
+void mcs_lock_t::lock()
+{
+    assert(tls_mcs_depth < c_mcs_depth);
+    node_t& node = tls_mcs_node[tls_mcs_depth++];
+    lock(node);
+    owner_ = &node;
+}
+
+void mcs_lock_t::unlock()
+{
+    assert(tls_mcs_depth > 0);
+    node_t* node = owner_;
+    // must be released in the reverse order they were taken
+    assert(node == &tls_mcs_node[tls_mcs_depth - 1]);
+    --tls_mcs_depth;
+    unlock(*node);
+}
+
+void futex_lock_t::lock()
+{
+    uint32_t state = c_unlocked;
+    if (state_.compare_exchange_strong(state, c_locked,
+            std::memory_order_acquire, std::memory_order_relaxed)) {
+        acquired(0);
+        return;
+    }
+    // the holder may be about to release, so spin briefly first
+    uint32_t spins = 0;
+    for (; spins < c_futex_spin; ++spins) {
+        cpu_relax();
+        state = c_unlocked;
+        if (state_.load(std::memory_order_relaxed) == c_unlocked &&
+            state_.compare_exchange_strong(state, c_locked,
+                std::memory_order_acquire, std::memory_order_relaxed)) {
+            acquired(spins);
+            return;
+        }
+    }
+    // mark the lock as having waiters and sleep until it is released.
+    // whoever takes it from here leaves it marked, which may cost a
+    // needless wake but never loses one.
+    state = state_.exchange(c_waiting, std::memory_order_acquire);
+    while (state != c_unlocked) {
+        futex_wait(&state_, c_waiting);
+        state = state_.exchange(c_waiting, std::memory_order_acquire);
+        ++spins;
+    }
+    acquired(spins);
+}
+
+void futex_lock_t::wake()
+{
+    futex_wake_one(&state_);
+}
+
+#if defined(TENGU_LOCK_STATS)
+struct lock_counter_t {
+    std::string name_;
+    std::atomic<uint64_t> acquires_;
+    std::atomic<uint64_t> contended_;
+    std::atomic<uint64_t> spins_;
+    std::atomic<uint64_t> hold_ns_;
+    std::atomic<uint64_t> max_hold_ns_;
+};
+
+namespace {
+uint64_t now_ns()
+{
+    typedef std::chrono::steady_clock clock_t;
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock_t::now().time_since_epoch()).count());
+}
+
+void clear(lock_counter_t& c)
+{
+    c.acquires_.store(0);
+    c.contended_.store(0);
+    c.spins_.store(0);
+    c.hold_ns_.store(0);
+    c.max_hold_ns_.store(0);
+}
+
+// all locks sharing a name share a counter
+struct lock_registry_t {
+
+    lock_counter_t* find(const char* name)
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        std::unique_ptr<lock_counter_t>& counter = counter_[name];
+        if (!counter) {
+            counter.reset(new lock_counter_t);
+            counter->name_ = name;
+            clear(*counter);
+        }
+        return counter.get();
+    }
+
+    static lock_registry_t& inst()
+    {
+        // leaked so locks in other statics can outlive it
+        static lock_registry_t* registry = new lock_registry_t;
+        return *registry;
+    }
+
+    std::mutex lock_;
+    std::map<std::string, std::unique_ptr<lock_counter_t>> counter_;
+};
+} // namespace {}
+
+lock_probe_t::lock_probe_t(const char* name)
+    : counter_(name ? lock_registry_t::inst().find(name) : nullptr)
+    , start_(0)
+{
+}
+
+void lock_probe_t::acquired(uint32_t spins)
+{
+    if (!counter_) {
+        return;
+    }
+    counter_->acquires_.fetch_add(1, std::memory_order_relaxed);
+    if (spins) {
+        counter_->contended_.fetch_add(1, std::memory_order_relaxed);
+        counter_->spins_.fetch_add(spins, std::memory_order_relaxed);
+    }
+    start_ = now_ns();
+}
+
+void lock_probe_t::released()
+{
+    if (!counter_) {
+        return;
+    }
+    const uint64_t held = now_ns() - start_;
+    counter_->hold_ns_.fetch_add(held, std::memory_order_relaxed);
+    uint64_t max = counter_->max_hold_ns_.load(std::memory_order_relaxed);
+    while (held > max && !counter_->max_hold_ns_.compare_exchange_weak(max, held,
+        std::memory_order_relaxed)) {
+    }
+}
+
+void lock_stats(std::vector<lock_stats_t>& out)
+{
+    lock_registry_t& registry = lock_registry_t::inst();
+    std::lock_guard<std::mutex> guard(registry.lock_);
+    out.clear();
+    for (const auto& pair : registry.counter_) {
+        const lock_counter_t& c = *pair.second;
+        lock_stats_t stats;
+        stats.name_ = c.name_.c_str();
+        stats.acquires_ = c.acquires_.load();
+        stats.contended_ = c.contended_.load();
+        stats.spins_ = c.spins_.load();
+        stats.hold_ns_ = c.hold_ns_.load();
+        stats.max_hold_ns_ = c.max_hold_ns_.load();
+        out.push_back(stats);
+    }
+}
+
+void lock_stats_reset()
+{
+    lock_registry_t& registry = lock_registry_t::inst();
+    std::lock_guard<std::mutex> guard(registry.lock_);
+    for (auto& pair : registry.counter_) {
+        clear(*pair.second);
+    }
+}
+#else
+void lock_stats(std::vector<lock_stats_t>& out)
+{
+    out.clear();
+}
+
+void lock_stats_reset()
+{
+}
+#endif
 } // namespace tengu
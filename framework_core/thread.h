@@ -1,5 +1,8 @@
 #pragma once
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <vector>
 #if defined(_MSC_VER)
 #include <intrin.h>
 #endif
@@ -45,15 +48,19 @@ struct atomic_t {
 
     long xchg(const long x)
     {
-        long o = __sync_lock_test_and_set(&v_, x);
-        __sync_synchronize();
-        return o;
+        // full barrier both ways, so unlocking a spinlock also publishes
+        // writes made while it was held
+        return __atomic_exchange_n(&v_, x, __ATOMIC_SEQ_CST);
     }
 #endif
 
     long operator()() const
     {
+#if defined(_MSC_VER)
         return v_;
+#else
+        return __atomic_load_n(&v_, __ATOMIC_SEQ_CST);
+#endif
     }
 
 protected:
@@ -62,44 +69,343 @@ protected:
 
 extern void yield();
 
-struct spinlock_t {
+// hint to the cpu that we are in a spin loop
+inline void cpu_relax()
+{
+#if defined(_MSC_VER)
+    _mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// exponential backoff for spin loops.  spins a doubling number of pause
+// instructions between attempts and falls back to yielding the thread
+// once that gets long.
+struct backoff_t {
+
+    enum : uint32_t {
+        c_max_spin = 1024,
+    };
+
+    backoff_t()
+        : spin_(1)
+        , count_(0)
+    {
+    }
+
+    void pause()
+    {
+        if (spin_ <= c_max_spin) {
+            for (uint32_t i = 0; i < spin_; ++i) {
+                cpu_relax();
+            }
+            spin_ *= 2;
+        } else {
+            yield();
+        }
+        ++count_;
+    }
 
-    spinlock_t()
-        : atom_(c_unlocked)
+    // number of times pause has been called
+    uint32_t count() const
     {
+        return count_;
     }
 
+protected:
+    uint32_t spin_;
+    uint32_t count_;
+};
+
+// statistics for all locks sharing a name
+struct lock_stats_t {
+    const char* name_;
+    // times the lock was taken, and how many of those had to wait
+    uint64_t acquires_;
+    uint64_t contended_;
+    // backoff iterations spent waiting
+    uint64_t spins_;
+    // time the lock was held
+    uint64_t hold_ns_;
+    uint64_t max_hold_ns_;
+};
+
+// copy out the statistics of every named lock.  locks only record
+// anything in builds with TENGU_LOCK_STATS defined.
+void lock_stats(std::vector<lock_stats_t>& out);
+void lock_stats_reset();
+
+#if defined(TENGU_LOCK_STATS)
+struct lock_counter_t;
+
+// records acquires and hold times for a named lock
+struct lock_probe_t {
+
+    explicit lock_probe_t(const char* name);
+
+    void acquired(uint32_t spins);
+    void released();
+
+protected:
+    lock_counter_t* counter_;
+    uint64_t start_;
+};
+#else
+// compiles away when not collecting lock statistics
+struct lock_probe_t {
+
+    explicit lock_probe_t(const char*)
+    {
+    }
+
+    void acquired(uint32_t)
+    {
+    }
+
+    void released()
+    {
+    }
+};
+#endif
+
+// test and test-and-set lock, for very short critical sections
+struct spinlock_t : protected lock_probe_t {
+
+    explicit spinlock_t(const char* name = nullptr)
+        : lock_probe_t(name)
+        , locked_(false)
+    {
+    }
+
+    spinlock_t(const spinlock_t&) = delete;
+    void operator=(const spinlock_t&) = delete;
+
     ~spinlock_t()
     {
-        assert(atom_() == c_unlocked);
+        assert(!locked_.load(std::memory_order_relaxed));
     }
 
     bool try_lock()
     {
-        return atom_.xchg(c_locked) == c_unlocked;
+        if (locked_.exchange(true, std::memory_order_acquire)) {
+            return false;
+        }
+        acquired(0);
+        return true;
     }
 
     void lock()
     {
-        while (!try_lock()) {
-            yield();
+        backoff_t backoff;
+        for (;;) {
+            if (!locked_.exchange(true, std::memory_order_acquire)) {
+                break;
+            }
+            // wait on a plain load so the cache line is not bounced around
+            // while the lock is held
+            while (locked_.load(std::memory_order_relaxed)) {
+                backoff.pause();
+            }
+        }
+        acquired(backoff.count());
+    }
+
+    void unlock()
+    {
+        assert(locked_.load(std::memory_order_relaxed));
+        released();
+        locked_.store(false, std::memory_order_release);
+    }
+
+protected:
+    std::atomic<bool> locked_;
+};
+
+// fair lock, threads acquire it in the order they arrived
+struct ticket_lock_t : protected lock_probe_t {
+
+    explicit ticket_lock_t(const char* name = nullptr)
+        : lock_probe_t(name)
+        , next_(0)
+        , serving_(0)
+    {
+    }
+
+    ticket_lock_t(const ticket_lock_t&) = delete;
+    void operator=(const ticket_lock_t&) = delete;
+
+    ~ticket_lock_t()
+    {
+        assert(next_.load() == serving_.load());
+    }
+
+    bool try_lock()
+    {
+        uint32_t ticket = serving_.load(std::memory_order_relaxed);
+        if (!next_.compare_exchange_strong(ticket, ticket + 1,
+                std::memory_order_acquire, std::memory_order_relaxed)) {
+            return false;
+        }
+        acquired(0);
+        return true;
+    }
+
+    void lock()
+    {
+        const uint32_t ticket = next_.fetch_add(1, std::memory_order_relaxed);
+        backoff_t backoff;
+        while (serving_.load(std::memory_order_acquire) != ticket) {
+            backoff.pause();
         }
-        assert(atom_() == c_locked);
+        acquired(backoff.count());
     }
 
     void unlock()
     {
-        assert(atom_() == c_locked);
-        atom_.xchg(c_unlocked);
+        released();
+        const uint32_t now = serving_.load(std::memory_order_relaxed);
+        serving_.store(now + 1, std::memory_order_release);
     }
 
 protected:
-    atomic_t atom_;
+    std::atomic<uint32_t> next_;
+    std::atomic<uint32_t> serving_;
+};
+
+// queue lock where each waiter spins on its own node, so a contended lock
+// does not hammer a single cache line.  lock() and unlock() use a per
+// thread node and must be released in reverse order of acquiring, or a
+// node can be passed in explicitly.
+struct mcs_lock_t : protected lock_probe_t {
+
+    struct node_t {
+        std::atomic<node_t*> next_;
+        std::atomic<bool> wait_;
+    };
+
+    explicit mcs_lock_t(const char* name = nullptr)
+        : lock_probe_t(name)
+        , tail_(nullptr)
+        , owner_(nullptr)
+    {
+    }
+
+    mcs_lock_t(const mcs_lock_t&) = delete;
+    void operator=(const mcs_lock_t&) = delete;
+
+    ~mcs_lock_t()
+    {
+        assert(tail_.load() == nullptr);
+    }
+
+    bool try_lock(node_t& node)
+    {
+        node.next_.store(nullptr, std::memory_order_relaxed);
+        node_t* expect = nullptr;
+        if (!tail_.compare_exchange_strong(expect, &node,
+                std::memory_order_acquire, std::memory_order_relaxed)) {
+            return false;
+        }
+        acquired(0);
+        return true;
+    }
+
+    void lock(node_t& node)
+    {
+        node.next_.store(nullptr, std::memory_order_relaxed);
+        node.wait_.store(true, std::memory_order_relaxed);
+        node_t* prev = tail_.exchange(&node, std::memory_order_acq_rel);
+        backoff_t backoff;
+        if (prev) {
+            // queue behind the previous owner and wait for it to hand over
+            prev->next_.store(&node, std::memory_order_release);
+            while (node.wait_.load(std::memory_order_acquire)) {
+                backoff.pause();
+            }
+        }
+        acquired(backoff.count());
+    }
 
-    enum : long {
+    void unlock(node_t& node)
+    {
+        released();
+        node_t* next = node.next_.load(std::memory_order_acquire);
+        if (!next) {
+            node_t* expect = &node;
+            if (tail_.compare_exchange_strong(expect, nullptr,
+                    std::memory_order_release, std::memory_order_relaxed)) {
+                return;
+            }
+            // a waiter has swapped the tail but not linked itself in yet
+            while (!(next = node.next_.load(std::memory_order_acquire))) {
+                cpu_relax();
+            }
+        }
+        next->wait_.store(false, std::memory_order_release);
+    }
+
+    void lock();
+    void unlock();
+
+protected:
+    std::atomic<node_t*> tail_;
+    // node used by lock(), only touched by the owner
+    node_t* owner_;
+};
+
+// lock which puts waiting threads to sleep in the kernel after a short
+// spin, for critical sections too long to spin through
+struct futex_lock_t : protected lock_probe_t {
+
+    explicit futex_lock_t(const char* name = nullptr)
+        : lock_probe_t(name)
+        , state_(c_unlocked)
+    {
+    }
+
+    futex_lock_t(const futex_lock_t&) = delete;
+    void operator=(const futex_lock_t&) = delete;
+
+    ~futex_lock_t()
+    {
+        assert(state_.load() == c_unlocked);
+    }
+
+    bool try_lock()
+    {
+        uint32_t expect = c_unlocked;
+        if (!state_.compare_exchange_strong(expect, c_locked,
+                std::memory_order_acquire, std::memory_order_relaxed)) {
+            return false;
+        }
+        acquired(0);
+        return true;
+    }
+
+    void lock();
+
+    void unlock()
+    {
+        released();
+        if (state_.exchange(c_unlocked, std::memory_order_release) == c_waiting) {
+            wake();
+        }
+    }
+
+protected:
+    void wake();
+
+    enum : uint32_t {
         c_unlocked = 0,
-        c_locked
+        c_locked,
+        // locked and there may be sleeping threads
+        c_waiting,
     };
+
+    std::atomic<uint32_t> state_;
 };
 
 template <typename lock_t>
@@ -1,6 +1,10 @@
 #pragma once
 #include <cassert>
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
 
 namespace tengu {
 template <typename type_t = uint64_t>
@@ -75,4 +79,228 @@ protected:
 
     type_t old_;
 };
+
+// runs tasks at their own fixed rates from a virtual clock, which is driven
+// by a real time source.  each frame the virtual clock moves forward by the
+// real time elapsed, capped at max_delta_ so a long stall (a breakpoint, a
+// window drag) is dropped rather than replayed.  fixed rate tasks are
+// stepped once per period that has passed, at most max_steps times a
+// frame, and display rate tasks run once per frame with the frame delta.
+template <typename type_t = uint64_t>
+struct frame_scheduler_t {
+    typedef type_t (*tick_func_t)();
+    typedef void (*sleep_func_t)(type_t ticks);
+    typedef std::function<void(float dt)> task_func_t;
+
+    // 'rate' is the number of ticks func returns per second
+    frame_scheduler_t(tick_func_t func, type_t rate)
+        : func_(func)
+        , sleep_(nullptr)
+        , rate_(rate)
+        , max_delta_(rate / 4)
+        , spin_(rate / 500)
+        , frame_hz_(0)
+    {
+        assert(rate_);
+        reset();
+    }
+
+    // add a task stepped 'hz' times per virtual second and at most
+    // 'max_steps' times per frame.  an 'hz' of zero runs the task once
+    // per frame.  returns an index for alpha() and steps().
+    uint32_t add(uint32_t hz, const task_func_t& func, uint32_t max_steps = 4)
+    {
+        task_t task;
+        task.func_ = func;
+        task.hz_ = hz;
+        task.max_steps_ = max_steps;
+        task.step_ = steps_due(hz);
+        task.run_ = 0;
+        task.dropped_ = 0;
+        task_.push_back(task);
+        return uint32_t(task_.size() - 1);
+    }
+
+    void reset()
+    {
+        real_ = get_time();
+        virtual_ = 0;
+        delta_ = 0;
+        for (task_t& task : task_) {
+            task.step_ = 0;
+        }
+        frame_base_ = real_;
+        frame_ = 0;
+    }
+
+    // advance the virtual clock to the current time and run the tasks
+    // which are due, in the order they were added
+    void tick()
+    {
+        const type_t now = get_time();
+        uint64_t delta = (now > real_) ? uint64_t(now - real_) : 0;
+        real_ = now;
+        if (delta > max_delta_) {
+            delta = max_delta_;
+        }
+        virtual_ += delta;
+        delta_ = delta;
+        for (task_t& task : task_) {
+            run(task);
+        }
+    }
+
+    // how far the virtual clock has got through a task's next step, in
+    // [0, 1).  render with lerp(previous, current, alpha).
+    float alpha(uint32_t index) const
+    {
+        const task_t& task = task_[index];
+        if (!task.hz_) {
+            return 1.f;
+        }
+        const uint64_t last = step_time(task.hz_, task.step_);
+        const float alpha = float(virtual_ - last) * float(task.hz_) / float(rate_);
+        return alpha < 1.f ? alpha : 1.f;
+    }
+
+    // number of steps run and dropped by a task
+    uint64_t steps(uint32_t index) const
+    {
+        return task_[index].run_;
+    }
+
+    uint64_t dropped(uint32_t index) const
+    {
+        return task_[index].dropped_;
+    }
+
+    // virtual time since reset and length of the last frame in seconds
+    double time() const
+    {
+        return double(virtual_) / double(rate_);
+    }
+
+    float deltaf() const
+    {
+        return float(delta_) / float(rate_);
+    }
+
+    // set the display rate used to pace frames in wait()
+    void set_frame_rate(uint32_t hz)
+    {
+        frame_hz_ = hz;
+        frame_base_ = get_time();
+        frame_ = 0;
+    }
+
+    // block until the next display frame is due.  sleeps while there is
+    // plenty of time left and spins through the last spin_ ticks, as a
+    // sleep alone can overshoot by a whole scheduler quantum.
+    void wait()
+    {
+        if (!frame_hz_) {
+            return;
+        }
+        ++frame_;
+        const type_t deadline = frame_base_ + type_t(step_time(frame_hz_, frame_));
+        for (;;) {
+            const type_t now = get_time();
+            if (now >= deadline) {
+                // more than a frame behind, start pacing again from here
+                // rather than rushing through the missed frames
+                if (uint64_t(now - deadline) * frame_hz_ > rate_) {
+                    frame_base_ = now;
+                    frame_ = 0;
+                }
+                return;
+            }
+            const type_t left = deadline - now;
+            if (left > spin_) {
+                sleep(left - spin_);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    tick_func_t func_;
+    // optional, used by wait() in place of std::this_thread::sleep_for
+    sleep_func_t sleep_;
+    type_t rate_;
+    // most the virtual clock may advance in one frame
+    uint64_t max_delta_;
+    // ticks before a frame deadline that wait() spins rather than sleeps
+    type_t spin_;
+
+protected:
+    struct task_t {
+        task_func_t func_;
+        uint32_t hz_;
+        uint32_t max_steps_;
+        // steps the virtual clock has passed, including dropped ones
+        uint64_t step_;
+        uint64_t run_;
+        uint64_t dropped_;
+    };
+
+    type_t get_time() const
+    {
+        return func_ ? func_() : 0;
+    }
+
+    // virtual time of a step, kept exact so rates which do not divide the
+    // tick rate do not drift
+    uint64_t step_time(uint32_t hz, uint64_t step) const
+    {
+        return step * uint64_t(rate_) / hz;
+    }
+
+    // whole steps which fit in the virtual time so far
+    uint64_t steps_due(uint32_t hz) const
+    {
+        return hz ? (virtual_ * hz) / uint64_t(rate_) : 0;
+    }
+
+    void run(task_t& task)
+    {
+        if (!task.hz_) {
+            task.func_(deltaf());
+            ++task.run_;
+            return;
+        }
+        const float dt = 1.f / float(task.hz_);
+        const uint64_t due = steps_due(task.hz_);
+        uint32_t count = 0;
+        for (; task.step_ < due && count < task.max_steps_; ++count) {
+            task.func_(dt);
+            ++task.step_;
+            ++task.run_;
+        }
+        // too far behind to catch up in one frame, skip what is left
+        if (task.step_ < due) {
+            task.dropped_ += due - task.step_;
+            task.step_ = due;
+        }
+    }
+
+    void sleep(type_t ticks)
+    {
+        if (sleep_) {
+            sleep_(ticks);
+        } else {
+            const uint64_t ns = uint64_t(ticks) * 1000000000ull / uint64_t(rate_);
+            std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+        }
+    }
+
+    std::vector<task_t> task_;
+    type_t real_;
+    // virtual clock, in ticks since reset
+    uint64_t virtual_;
+    uint64_t delta_;
+    // frame pacing
+    uint32_t frame_hz_;
+    type_t frame_base_;
+    uint64_t frame_;
+};
 } // namespace tengu
@@ -0,0 +1,199 @@
+#include "wheel.h"
+
+namespace tengu {
+
+timer_wheel_t::timer_wheel_t()
+    : free_(c_none)
+    , size_(0)
+    , time_(0)
+{
+    for (list_t& l : slot_) {
+        l = list_t{ c_none, c_none };
+    }
+}
+
+timer_wheel_t::~timer_wheel_t()
+{
+    clear();
+}
+
+uint32_t timer_wheel_t::alloc()
+{
+    if (free_ == c_none) {
+        // grow the arena by a chunk and thread it onto the free list
+        const uint32_t base = uint32_t(capacity());
+        std::unique_ptr<node_t[]> chunk(new node_t[c_chunk_size]);
+        for (uint32_t i = 0; i < c_chunk_size; ++i) {
+            node_t& n = chunk[i];
+            n.invoke_ = nullptr;
+            n.destroy_ = nullptr;
+            n.next_ = (i + 1 < c_chunk_size) ? base + i + 1 : c_none;
+            n.prev_ = c_none;
+            n.slot_ = c_none;
+            n.gen_ = 1;
+        }
+        chunk_.push_back(std::move(chunk));
+        free_ = base;
+    }
+    const uint32_t index = free_;
+    free_ = node(index).next_;
+    return index;
+}
+
+void timer_wheel_t::release(uint32_t index)
+{
+    node_t& n = node(index);
+    n.destroy_(n.store_);
+    n.invoke_ = nullptr;
+    n.destroy_ = nullptr;
+    n.slot_ = c_none;
+    // bump the generation so outstanding handles go stale, skipping zero
+    n.gen_ = (n.gen_ + 1) ? n.gen_ + 1 : 1;
+    n.next_ = free_;
+    free_ = index;
+}
+
+void timer_wheel_t::insert(uint32_t index)
+{
+    node_t& n = node(index);
+    assert(n.expires_ >= time_);
+    const uint64_t delta = n.expires_ - time_;
+    // coarsest level needed to reach the deadline.  a timer in level n is
+    // always at least one level n slot ahead, so it is never filed in the
+    // slot which was cascaded at the start of the current period.
+    uint32_t level = 0;
+    while (level + 1 < c_levels && (delta >> (c_bits * (level + 1))) != 0) {
+        ++level;
+    }
+    const uint32_t slot = level * c_slots +
+        uint32_t((n.expires_ >> (c_bits * level)) & (c_slots - 1));
+    // append so timers due on the same tick fire in schedule order
+    list_t& l = slot_[slot];
+    n.slot_ = slot;
+    n.next_ = c_none;
+    n.prev_ = l.tail_;
+    if (l.tail_ != c_none) {
+        node(l.tail_).next_ = index;
+    } else {
+        l.head_ = index;
+    }
+    l.tail_ = index;
+}
+
+void timer_wheel_t::unlink(uint32_t index)
+{
+    node_t& n = node(index);
+    list_t& l = slot_[n.slot_];
+    if (n.prev_ != c_none) {
+        node(n.prev_).next_ = n.next_;
+    } else {
+        l.head_ = n.next_;
+    }
+    if (n.next_ != c_none) {
+        node(n.next_).prev_ = n.prev_;
+    } else {
+        l.tail_ = n.prev_;
+    }
+    n.next_ = c_none;
+    n.prev_ = c_none;
+}
+
+const timer_wheel_t::node_t* timer_wheel_t::find(timer_handle_t handle) const
+{
+    if (!handle.valid() || handle.index_ >= capacity()) {
+        return nullptr;
+    }
+    const node_t& n = node(handle.index_);
+    if (n.gen_ != handle.gen_ || n.slot_ == c_none || n.slot_ == c_firing) {
+        return nullptr;
+    }
+    return &n;
+}
+
+bool timer_wheel_t::cancel(timer_handle_t handle)
+{
+    if (!find(handle)) {
+        return false;
+    }
+    unlink(handle.index_);
+    release(handle.index_);
+    --size_;
+    return true;
+}
+
+bool timer_wheel_t::pending(timer_handle_t handle) const
+{
+    return find(handle) != nullptr;
+}
+
+uint64_t timer_wheel_t::remaining(timer_handle_t handle) const
+{
+    const node_t* n = find(handle);
+    return n ? n->expires_ - time_ : 0;
+}
+
+void timer_wheel_t::cascade(uint32_t level)
+{
+    // refile everything in the slot which has just come round.  they all
+    // land in finer levels so the list can be taken whole.
+    list_t& l = slot_[level * c_slots +
+        uint32_t((time_ >> (c_bits * level)) & (c_slots - 1))];
+    uint32_t index = l.head_;
+    l = list_t{ c_none, c_none };
+    while (index != c_none) {
+        const uint32_t next = node(index).next_;
+        insert(index);
+        assert(node(index).slot_ / c_slots < level);
+        index = next;
+    }
+}
+
+void timer_wheel_t::tick()
+{
+    ++time_;
+    // each time a level wraps, pull down the next slot of the level above
+    for (uint32_t level = 1; level < c_levels; ++level) {
+        if ((time_ & ((uint64_t(1) << (c_bits * level)) - 1)) != 0) {
+            break;
+        }
+        cascade(level);
+    }
+    list_t& l = slot_[time_ & (c_slots - 1)];
+    while (l.head_ != c_none) {
+        const uint32_t index = l.head_;
+        unlink(index);
+        --size_;
+        // the node stays allocated while its callback runs, so it can not
+        // be handed out again or cancelled from within the callback
+        node_t& n = node(index);
+        assert(n.expires_ == time_);
+        n.slot_ = c_firing;
+        n.invoke_(n.store_);
+        release(index);
+    }
+}
+
+void timer_wheel_t::advance(uint64_t ticks)
+{
+    for (; ticks && size_; --ticks) {
+        tick();
+    }
+    // nothing left to fire so skip straight to the end
+    time_ += ticks;
+}
+
+void timer_wheel_t::clear()
+{
+    for (list_t& l : slot_) {
+        uint32_t index = l.head_;
+        while (index != c_none) {
+            const uint32_t next = node(index).next_;
+            release(index);
+            index = next;
+        }
+        l = list_t{ c_none, c_none };
+    }
+    size_ = 0;
+}
+
+} // namespace tengu
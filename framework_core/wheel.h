@@ -0,0 +1,232 @@
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tengu {
+
+// weak reference to a scheduled timer.  once the timer has fired or been
+// cancelled its slot is recycled under a new generation so the handle goes
+// stale rather than cancelling someone else's timer.
+struct timer_handle_t {
+
+    timer_handle_t()
+        : index_(0)
+        , gen_(0)
+    {
+    }
+
+    timer_handle_t(uint32_t index, uint32_t gen)
+        : index_(index)
+        , gen_(gen)
+    {
+    }
+
+    // generations start at one so a default handle is never valid
+    bool valid() const
+    {
+        return gen_ != 0;
+    }
+
+    bool operator==(const timer_handle_t& rhs) const
+    {
+        return index_ == rhs.index_ && gen_ == rhs.gen_;
+    }
+
+    bool operator!=(const timer_handle_t& rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    uint32_t index_;
+    uint32_t gen_;
+};
+
+// hierarchical timing wheel.  time is measured in whole ticks which mean
+// whatever the owner advances it by, usually frames.  four levels of 256
+// slots each cover 256^n ticks, a timer is filed in the coarsest level its
+// deadline needs and trickles down as the finer levels come round, so
+// schedule, cancel and fire are all O(1).  timers live in an arena of
+// pooled nodes threaded onto per slot lists, and small callbacks are held
+// inline in their node so a steady stream of timers does not allocate.
+struct timer_wheel_t {
+
+    enum : uint32_t {
+        c_bits = 8,
+        c_slots = 1 << c_bits,
+        c_levels = 4,
+        // nodes per arena chunk, chunks never move once allocated
+        c_chunk_size = 256,
+        c_none = 0xffffffffu,
+        // slot_ of a node whose callback is running
+        c_firing = 0xfffffffeu,
+    };
+
+    enum : uint64_t {
+        // longest delay which can be scheduled, longer ones are clamped
+        c_max_delay = (uint64_t(1) << (c_bits * c_levels)) - 1,
+    };
+
+    enum : size_t {
+        // callables up to this size are stored in the node itself
+        c_inline_size = 48,
+    };
+
+    timer_wheel_t();
+    ~timer_wheel_t();
+
+    timer_wheel_t(const timer_wheel_t&) = delete;
+    void operator=(const timer_wheel_t&) = delete;
+
+    // call func() once 'delay' ticks from now.  a delay of zero fires on
+    // the next advance().  func may schedule and cancel timers itself.
+    template <typename func_t>
+    timer_handle_t schedule(uint64_t delay, func_t&& func)
+    {
+        typedef typename std::decay<func_t>::type call_t;
+        const uint32_t index = alloc();
+        node_t& n = node(index);
+        store<call_t>(n, std::forward<func_t>(func),
+            std::integral_constant<bool, (sizeof(call_t) <= c_inline_size &&
+                alignof(call_t) <= alignof(std::max_align_t))>());
+        delay = delay ? delay : 1;
+        delay = delay < c_max_delay ? delay : c_max_delay;
+        n.expires_ = time_ + delay;
+        insert(index);
+        ++size_;
+        return timer_handle_t(index, n.gen_);
+    }
+
+    // stop a pending timer.  returns false if it already fired, was
+    // already cancelled or the handle is stale.
+    bool cancel(timer_handle_t handle);
+
+    // true if the timer has yet to fire
+    bool pending(timer_handle_t handle) const;
+
+    // ticks left until a pending timer fires, zero if it is not pending
+    uint64_t remaining(timer_handle_t handle) const;
+
+    // move time forward, firing timers as their deadline is reached.
+    // timers due on the same tick fire in the order they were scheduled.
+    void advance(uint64_t ticks = 1);
+
+    // cancel every pending timer
+    void clear();
+
+    // ticks advanced so far
+    uint64_t now() const
+    {
+        return time_;
+    }
+
+    // number of pending timers
+    size_t size() const
+    {
+        return size_;
+    }
+
+    // nodes held by the arena, pending or free
+    size_t capacity() const
+    {
+        return chunk_.size() * c_chunk_size;
+    }
+
+protected:
+    typedef void (*invoke_t)(void*);
+
+    struct node_t {
+        // type erased callable held in store_
+        invoke_t invoke_;
+        invoke_t destroy_;
+        uint64_t expires_;
+        // slot list links, next_ also threads the free list
+        uint32_t next_;
+        uint32_t prev_;
+        // slot this node is filed in, c_none when free
+        uint32_t slot_;
+        uint32_t gen_;
+        alignas(std::max_align_t) uint8_t store_[c_inline_size];
+    };
+
+    struct list_t {
+        uint32_t head_;
+        uint32_t tail_;
+    };
+
+    template <typename call_t>
+    static void invoke_inline(void* p)
+    {
+        (*static_cast<call_t*>(p))();
+    }
+
+    template <typename call_t>
+    static void destroy_inline(void* p)
+    {
+        static_cast<call_t*>(p)->~call_t();
+    }
+
+    template <typename call_t>
+    static void invoke_boxed(void* p)
+    {
+        (**static_cast<call_t**>(p))();
+    }
+
+    template <typename call_t>
+    static void destroy_boxed(void* p)
+    {
+        delete *static_cast<call_t**>(p);
+    }
+
+    template <typename call_t, typename func_t>
+    void store(node_t& n, func_t&& func, std::true_type)
+    {
+        new (n.store_) call_t(std::forward<func_t>(func));
+        n.invoke_ = &invoke_inline<call_t>;
+        n.destroy_ = &destroy_inline<call_t>;
+    }
+
+    // large callables spill to the heap
+    template <typename call_t, typename func_t>
+    void store(node_t& n, func_t&& func, std::false_type)
+    {
+        call_t* boxed = new call_t(std::forward<func_t>(func));
+        memcpy(n.store_, &boxed, sizeof(boxed));
+        n.invoke_ = &invoke_boxed<call_t>;
+        n.destroy_ = &destroy_boxed<call_t>;
+    }
+
+    node_t& node(uint32_t index)
+    {
+        return chunk_[index / c_chunk_size][index % c_chunk_size];
+    }
+
+    const node_t& node(uint32_t index) const
+    {
+        return chunk_[index / c_chunk_size][index % c_chunk_size];
+    }
+
+    const node_t* find(timer_handle_t handle) const;
+
+    uint32_t alloc();
+    void release(uint32_t index);
+    void insert(uint32_t index);
+    void unlink(uint32_t index);
+    void cascade(uint32_t level);
+    void tick();
+
+    std::vector<std::unique_ptr<node_t[]>> chunk_;
+    std::array<list_t, c_slots * c_levels> slot_;
+    uint32_t free_;
+    size_t size_;
+    uint64_t time_;
+};
+
+} // namespace tengu
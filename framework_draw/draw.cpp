@@ -3,6 +3,7 @@
 #include <cstdio>
 
 #include "../framework_core/common.h"
+#include "../framework_core/profile.h"
 #include "draw.h"
 
 namespace tengu {
@@ -96,6 +97,7 @@ constexpr uint32_t _blend_dither(const uint32_t src,
 
 void draw_t::clear()
 {
+    TENGU_PROFILE_ZONE("draw.clear");
     assert(target_);
     const uint32_t pitch = target_->width();
     const uint32_t colour = colour_;
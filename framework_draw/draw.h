@@ -214,4 +214,11 @@ public:
     uint32_t & key_;
     vec2i_t offset_;
 };
+
+// print the profiler's totals for the last frame, one line per zone and
+// counter.  empty unless built with TENGU_PROFILE.
+void draw_profile(draw_t& draw,
+                  const font_t& font,
+                  const vec2i_t& pos);
+
 } // namespace tengu
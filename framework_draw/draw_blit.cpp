@@ -3,6 +3,7 @@
 #include <cstdio>
 
 #include "../framework_core/common.h"
+#include "../framework_core/profile.h"
 #include "draw.h"
 
 namespace tengu {
@@ -284,6 +285,7 @@ void _draw_t_blit_1(bitmap_t& target,
 // 1:1 sprite blit (hflip dispatch)
 void draw_t::blit(const blit_info_t& info)
 {
+    TENGU_PROFILE_ZONE("draw.blit");
     assert(target_ && info.bitmap_->valid());
     // dispatch based on hflip
     if (info.h_flip_) {
@@ -296,6 +298,7 @@ void draw_t::blit(const blit_info_t& info)
 // tilemap blit function
 void draw_t::blit(const tilemap_t& tiles, const vec2i_t& p)
 {
+    TENGU_PROFILE_ZONE("draw.blit_tiles");
     // cell size
     const int32_t cell_w = tiles.cell_size_.x;
     const int32_t cell_h = tiles.cell_size_.y;
@@ -344,6 +347,7 @@ void draw_t::blit(const tilemap_t& tiles, const vec2i_t& p)
 // rotosprite blit
 void draw_t::blit(const blit_info_ex_t& info)
 {
+    TENGU_PROFILE_ZONE("draw.blit_ex");
     assert(info.bitmap_ && info.bitmap_->valid());
     // blit function prototype
     typedef void (*blit_func_t)(bitmap_t & target,
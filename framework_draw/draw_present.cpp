@@ -3,6 +3,7 @@
 #include <cstdio>
 
 #include "../framework_core/common.h"
+#include "../framework_core/profile.h"
 #include "draw.h"
 
 namespace tengu {
@@ -10,6 +11,7 @@ namespace tengu {
 // render at 1:1 scale
 void draw_t::render_1x(void* mem, const uint32_t pitch)
 {
+    TENGU_PROFILE_ZONE("draw.render_1x");
     assert(mem);
     // data access
     uint32_t* dst = reinterpret_cast<uint32_t*>(mem);
@@ -32,6 +34,7 @@ void draw_t::render_1x(void* mem, const uint32_t pitch)
 // render at 1:2 scale
 void draw_t::render_2x(void* mem, const uint32_t pitch)
 {
+    TENGU_PROFILE_ZONE("draw.render_2x");
     assert(mem);
     // data access
     uint32_t* dst = reinterpret_cast<uint32_t*>(mem);
@@ -59,6 +62,7 @@ void draw_t::render_2x(void* mem, const uint32_t pitch)
 // render at 1:3 scale
 void draw_t::render_3x(void* mem, const uint32_t pitch)
 {
+    TENGU_PROFILE_ZONE("draw.render_3x");
     assert(mem);
     // data access
     uint32_t* dst = reinterpret_cast<uint32_t*>(mem);
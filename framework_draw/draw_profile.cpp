@@ -0,0 +1,37 @@
+#include <vector>
+
+#include "../framework_core/profile.h"
+#include "draw.h"
+
+namespace tengu {
+
+void draw_profile(draw_t& draw,
+    const font_t& font,
+    const vec2i_t& pos)
+{
+    std::vector<profile_stat_t> stats;
+    profiler_t::inst().stats(stats);
+    if (stats.empty()) {
+        return;
+    }
+    const int32_t bottom = draw.get_target().height() - font.cellh_;
+    vec2i_t p = pos;
+    draw.printf(font, p, "frame %6.2fms", profiler_t::inst().frame_ms());
+    p.y += font.cellh_;
+    for (const profile_stat_t& s : stats) {
+        if (p.y > bottom) {
+            break;
+        }
+        // indent nested zones under their parents
+        const vec2i_t at = vec2i_t{ p.x + int32_t(s.depth_) * font.spacing_, p.y };
+        if (s.type_ == e_profile_zone) {
+            draw.printf(font, at, "%u %s %.2fms x%u",
+                s.thread_, s.name_, s.value_, s.count_);
+        } else {
+            draw.printf(font, at, "%u %s %g", s.thread_, s.name_, s.value_);
+        }
+        p.y += font.cellh_;
+    }
+}
+
+} // namespace tengu
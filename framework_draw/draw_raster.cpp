@@ -3,6 +3,7 @@
 #include <cstdio>
 
 #include "../framework_core/common.h"
+#include "../framework_core/profile.h"
 #include "draw.h"
 
 namespace tengu {
@@ -23,6 +24,7 @@ void draw_t::triangle(
     const vec2f_t& v1,
     const vec2f_t& v2)
 {
+    TENGU_PROFILE_ZONE("draw.triangle");
     // triangle bounds
     int32_t minx = int32_t(minv(v0.x, v1.x, v2.x));
     int32_t maxx = int32_t(maxv(v0.x, v1.x, v2.x));
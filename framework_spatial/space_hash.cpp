@@ -1,6 +1,7 @@
 #include <assert.h>
 
 #include "../framework_core/common.h"
+#include "../framework_core/profile.h"
 #include "space_hash.h"
 
 namespace tengu {
@@ -119,6 +120,7 @@ void spatial_t::move(
     const bound_t& ob0,
     const bound_t& ob1)
 {
+    TENGU_PROFILE_ZONE("spatial.move");
     // return if bounds are the same
     if (ob0 == ob1) {
         return;
@@ -141,6 +143,7 @@ void spatial_t::move(
 
 void spatial_t::query_collisions(body_pair_set_t& out)
 {
+    TENGU_PROFILE_ZONE("spatial.query_collisions");
     uint32_t compares = 0;
     // for each cell
     for (auto& cell : hash_) {
@@ -174,9 +177,7 @@ void spatial_t::query_collisions(body_pair_set_t& out)
             }
         }
     }
-#if 0
-    printf("?> %d\n", compares);
-#endif
+    TENGU_PROFILE_COUNTER("spatial.compares", compares);
 }
 
 void spatial_t::query_radius(
@@ -184,6 +185,7 @@ void spatial_t::query_radius(
     float r,
     body_set_t& out)
 {
+    TENGU_PROFILE_ZONE("spatial.query_radius");
     //
     const float rr = r * r;
 
@@ -214,6 +216,7 @@ void spatial_t::query_rect(
     const vec2f_t& p1,
     body_set_t& out)
 {
+    TENGU_PROFILE_ZONE("spatial.query_rect");
     // transform bounds into hash space
     int32_t sx0 = int32_t(p0.x), sy0 = int32_t(p0.y);
     int32_t sx1 = int32_t(p1.x), sy1 = int32_t(p1.y);
@@ -0,0 +1,37 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace bench {
+
+// simple wall clock stopwatch for timing benchmark sections
+struct stopwatch_t {
+
+    typedef std::chrono::steady_clock clock_t;
+
+    stopwatch_t()
+        : start_(clock_t::now())
+    {
+    }
+
+    void reset() {
+        start_ = clock_t::now();
+    }
+
+    // elapsed time in nanoseconds
+    uint64_t elapsed_ns() const {
+        const auto diff = clock_t::now() - start_;
+        return uint64_t(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count());
+    }
+
+    double elapsed_us() const {
+        return double(elapsed_ns()) / 1000.0;
+    }
+
+protected:
+    clock_t::time_point start_;
+};
+
+} // namespace bench
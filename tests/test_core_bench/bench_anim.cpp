@@ -0,0 +1,92 @@
+#include <array>
+#include <vector>
+#include "bench.h"
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/anim.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+// ticking thousands of sprites through controller_t one at a time
+// against all of them at once through system_t
+struct bench_anim_t : public test_t {
+
+    bench_anim_t()
+        : test_t("bench_anim_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        const uint32_t sprites = 5000;
+        const uint32_t frames = 600;
+        anim::sheet_t sheet(256, 256);
+        sheet.add_grid(32, 32);
+        anim::sequence_t walk("walk", anim::sequence_t::e_end_loop);
+        walk.op_interval(100).op_event(1).op_frame(0).op_frame(1)
+            .op_frame(2).op_event(1).op_frame(3).op_delay(50).op_frame(4)
+            .op_frame(5).op_frame(6).op_frame(7);
+
+        std::vector<anim::controller_t> control(sprites);
+        for (anim::controller_t& c : control) {
+            c.set_sheet(&sheet);
+            c.push_sequence(&walk);
+        }
+        anim::system_t sys;
+        const uint32_t prog = sys.compile(walk);
+        for (uint32_t i = 0; i < sprites; ++i) {
+            sys.push_sequence(sys.create(&sheet), prog);
+        }
+
+        uint64_t events = 0;
+        bench::stopwatch_t timer;
+        for (uint32_t f = 0; f < frames; ++f) {
+            for (anim::controller_t& c : control) {
+                c.tick(16);
+                uint32_t e;
+                while (c.get_event(e)) {
+                    ++events;
+                }
+            }
+        }
+        const double control_us = timer.elapsed_us() / frames;
+
+        uint64_t fired = 0;
+        timer.reset();
+        for (uint32_t f = 0; f < frames; ++f) {
+            sys.tick(16);
+            fired += sys.events().size();
+        }
+        const double system_us = timer.elapsed_us() / frames;
+
+        // a long stall, such as after a window drag.  the events raised
+        // on the way cost the same either way, so this uses a sequence
+        // without any to time finding the new position.
+        anim::sequence_t spin("spin", anim::sequence_t::e_end_loop);
+        spin.op_interval(100).op_frame(0).op_frame(1).op_delay(50)
+            .op_frame(2).op_frame(3);
+        const uint32_t spin_prog = sys.compile(spin);
+        for (uint32_t i = 0; i < sprites; ++i) {
+            control[i].set_sequence(&spin);
+            sys.set_sequence(i, spin_prog);
+        }
+        timer.reset();
+        for (anim::controller_t& c : control) {
+            c.tick(1000000);
+        }
+        const double control_skip_us = timer.elapsed_us();
+        timer.reset();
+        sys.tick(1000000);
+        const double system_skip_us = timer.elapsed_us();
+
+        printf("  controller_t: %7.1f us per frame\n", control_us);
+        printf("  system_t:     %7.1f us per frame\n", system_us);
+        printf("  controller_t: %7.1f us for a 1000s step\n", control_skip_us);
+        printf("  system_t:     %7.1f us for a 1000s step\n", system_skip_us);
+        return events == fired;
+    }
+};
+
+static std::array<test_lib::register_t*, 1> reg_test = {
+    test_lib::register_t::test<bench_anim_t>()
+};
@@ -0,0 +1,103 @@
+#include <array>
+#include <vector>
+#include "bench.h"
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/event.h"
+#include "../../framework_core/random.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+namespace {
+struct count_listener_t : public event_listener_t {
+
+    count_listener_t()
+        : count_(0)
+    {
+    }
+
+    virtual void recieve_event(const event_t*) override
+    {
+        ++count_;
+    }
+
+    uint64_t count_;
+};
+
+struct bench_event_t : public event_t {
+
+    bench_event_t(event_type_t type, uint32_t value)
+        : event_t(type)
+        , value_(value)
+    {
+    }
+
+    uint32_t value_;
+};
+} // namespace {}
+
+// send events of 64 types to 1k listeners each filtering on a few types
+struct bench_event_send_t : public test_t {
+
+    bench_event_send_t()
+        : test_t("bench_event_send_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        const size_t listeners = 1000;
+        const uint32_t types = 64;
+        const size_t sends = 1 << 20;
+
+        random_t random(0x2468);
+        event_stream_t stream;
+        std::vector<count_listener_t> listener(listeners);
+        for (size_t i = 0; i < listeners; ++i) {
+            std::array<event_type_t, 4> filter;
+            for (event_type_t& type : filter) {
+                type = random.rand_range<uint32_t>(0, types);
+            }
+            stream.add<4>(&listener[i], filter);
+        }
+        // a few listeners see everything
+        for (size_t i = 0; i < 4; ++i) {
+            stream.add(&listener[i]);
+        }
+
+        std::vector<bench_event_t> events;
+        for (size_t i = 0; i < sends; ++i) {
+            events.push_back(
+                bench_event_t(random.rand_range<uint32_t>(0, types), 0));
+        }
+
+        bench::stopwatch_t timer;
+        for (const bench_event_t& e : events) {
+            stream.send(&e);
+        }
+        const double send_ns = double(timer.elapsed_ns());
+
+        timer.reset();
+        for (size_t i = 0; i < sends; i += 4096) {
+            for (size_t j = i; j < i + 4096; ++j) {
+                stream.post(events[j]);
+            }
+            stream.dispatch();
+        }
+        const double queue_ns = double(timer.elapsed_ns());
+
+        uint64_t received = 0;
+        for (const count_listener_t& l : listener) {
+            received += l.count_;
+        }
+        printf("  send:     %.2f M events/s (%.1f ns/delivery)\n",
+            1000.0 * sends / send_ns, send_ns * 2 / double(received));
+        printf("  dispatch: %.2f M events/s (%.1f ns/delivery)\n",
+            1000.0 * sends / queue_ns, queue_ns * 2 / double(received));
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 1> reg_test = {
+    test_lib::register_t::test<bench_event_send_t>()
+};
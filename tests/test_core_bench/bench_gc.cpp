@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+#include "bench.h"
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/gc.h"
+#include "../../framework_core/random.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+namespace {
+struct node_t : public gc_object_t {
+
+    node_t()
+        : a_(nullptr)
+        , b_(nullptr)
+    {
+    }
+
+    node_t *a_, *b_;
+
+    static void gc_enum(const gc_object_t *o,
+                        std::vector<const gc_object_t *> &out) {
+        const node_t *n = static_cast<const node_t *>(o);
+        if (n->a_) { out.push_back(n->a_); }
+        if (n->b_) { out.push_back(n->b_); }
+    }
+};
+
+struct dag_node_t : public gc_object_t {
+
+    dag_node_t()
+    {
+        memset(edge_, 0, sizeof(edge_));
+    }
+
+    dag_node_t *edge_[4];
+
+    static void gc_enum(const gc_object_t *o,
+                        std::vector<const gc_object_t *> &out) {
+        const dag_node_t *n = static_cast<const dag_node_t *>(o);
+        for (const dag_node_t *e : n->edge_) {
+            if (e) { out.push_back(e); }
+        }
+    }
+};
+
+// build a linked list of 'count' nodes
+node_t *build_list(gc_t &gc, size_t count) {
+    node_t *head = nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        node_t *n = gc.alloc<node_t>();
+        n->a_ = head;
+        head = n;
+    }
+    return head;
+}
+
+// build a random dag where every node hangs off an earlier one and the
+// spare edges point forwards to random later nodes
+dag_node_t *build_dag(gc_t &gc, size_t count, random_t &random) {
+    std::vector<dag_node_t *> nodes;
+    nodes.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        nodes.push_back(gc.alloc<dag_node_t>());
+    }
+    for (size_t i = 1; i < count; ++i) {
+        dag_node_t *parent = nodes[random.rand_range<size_t>(0, i)];
+        for (dag_node_t *&e : parent->edge_) {
+            if (!e) {
+                e = nodes[i];
+                break;
+            }
+        }
+    }
+    for (size_t i = 0; i < count - 1; ++i) {
+        for (dag_node_t *&e : nodes[i]->edge_) {
+            if (!e) {
+                e = nodes[random.rand_range<size_t>(i + 1, count)];
+            }
+        }
+    }
+    return nodes[0];
+}
+
+// build a binary tree of 'count' nodes where the last 'garbage' nodes are
+// unreachable
+node_t *build_tree(gc_t &gc, size_t count, size_t garbage) {
+    std::vector<node_t *> nodes;
+    nodes.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        nodes.push_back(gc.alloc<node_t>());
+    }
+    const size_t live = count - garbage;
+    for (size_t i = 1; i < live; ++i) {
+        node_t *parent = nodes[(i - 1) / 2];
+        (i & 1 ? parent->a_ : parent->b_) = nodes[i];
+    }
+    return nodes[0];
+}
+} // namespace {}
+
+// time a full collection of a binary tree where half of the heap is garbage
+struct bench_gc_collect_t : public test_t {
+
+    bench_gc_collect_t()
+        : test_t("bench_gc_collect_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        for (size_t count = 1 << 14; count <= (1 << 20); count <<= 2) {
+            gc_t gc;
+            node_t *root = build_tree(gc, count, count / 2);
+            bench::stopwatch_t timer;
+            gc.check_in(root);
+            gc.collect();
+            const uint64_t ns = timer.elapsed_ns();
+            if (gc.allocs().size() != count - count / 2) {
+                return false;
+            }
+            printf("  collect %7d objects: %8.1f us (%.1f ns/object)\n",
+                int(count), double(ns) / 1000.0, double(ns) / double(count));
+        }
+        return true;
+    }
+};
+
+// run incremental cycles over a heap of 1M objects while mutating it each
+// frame, and report the longest step() against the budget it was given
+struct bench_gc_step_t : public test_t {
+
+    bench_gc_step_t()
+        : test_t("bench_gc_step_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        const size_t count = 1 << 20;
+        const uint32_t budget_us = 1000;
+
+        random_t random(0x1234);
+        gc_t gc;
+        node_t *root = build_tree(gc, count, 0);
+
+        bench::stopwatch_t timer;
+        gc.check_in(root);
+        gc.collect();
+        const double full_us = timer.elapsed_us();
+
+        std::vector<uint64_t> times;
+        uint64_t total_ns = 0;
+        int frames = 0, cycles = 0;
+        while (cycles < 8) {
+            // replace a few subtrees with fresh nodes
+            for (int i = 0; i < 64; ++i) {
+                const auto &a = gc.allocs();
+                node_t *n = static_cast<node_t *>(
+                    a[random.rand_range<size_t>(0, a.size())]);
+                gc.write(n, n->b_, gc.alloc<node_t>());
+            }
+            gc.check_in(root);
+            timer.reset();
+            cycles += gc.step(budget_us) ? 1 : 0;
+            const uint64_t ns = timer.elapsed_ns();
+            times.push_back(ns);
+            total_ns += ns;
+            ++frames;
+        }
+        std::sort(times.begin(), times.end());
+        const uint64_t p99_ns = times[times.size() * 99 / 100];
+        const uint64_t worst_ns = times.back();
+        printf("  full collect %d objects: %.1f us\n", int(count), full_us);
+        printf("  incremental: %d frames/cycle, mean %.1f us, p99 %.1f us, "
+               "worst %.1f us (budget %d us)\n",
+            frames / cycles, double(total_ns) / (1000.0 * frames),
+            double(p99_ns) / 1000.0, double(worst_ns) / 1000.0,
+            int(budget_us));
+        return true;
+    }
+};
+
+// allocate short lived objects each frame on top of a 1M object old heap
+// and compare minor collections against full ones
+struct bench_gc_minor_t : public test_t {
+
+    bench_gc_minor_t()
+        : test_t("bench_gc_minor_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        const size_t count = 1 << 20;
+        const size_t per_frame = 10000;
+        const int frames = 32;
+
+        random_t random(0x4321);
+        gc_t gc;
+        node_t *root = build_tree(gc, count, 0);
+        gc.check_in(root);
+        gc.collect_minor();
+
+        uint64_t minor_ns = 0, full_ns = 0;
+        for (int f = 0; f < frames; ++f) {
+            for (size_t i = 0; i < per_frame; ++i) {
+                node_t *n = gc.alloc<node_t>();
+                // one in a hundred is kept alive by the old heap
+                if (i % 100 == 0) {
+                    const auto &a = gc.allocs();
+                    node_t *owner = static_cast<node_t *>(
+                        a[random.rand_range<size_t>(0, count)]);
+                    gc.write(owner, owner->b_, n);
+                }
+            }
+            gc.check_in(root);
+            bench::stopwatch_t timer;
+            if (f & 1) {
+                gc.collect();
+                full_ns += timer.elapsed_ns();
+            } else {
+                gc.collect_minor();
+                minor_ns += timer.elapsed_ns();
+            }
+        }
+        printf("  %d young objects/frame on %d old:\n", int(per_frame),
+            int(count));
+        printf("  minor collect: %.1f us, full collect: %.1f us\n",
+            double(minor_ns) / (500.0 * frames),
+            double(full_ns) / (500.0 * frames));
+        return true;
+    }
+};
+
+// compare serial and parallel marking on a few shapes of object graph
+struct bench_gc_mark_t : public test_t {
+
+    bench_gc_mark_t()
+        : test_t("bench_gc_mark_t")
+    {
+    }
+
+    // time full collections of a heap where everything is live
+    template <typename build_t>
+    static double time_collect(uint32_t threads, const build_t &build) {
+        gc_t gc;
+        gc.set_threads(threads);
+        const gc_object_t *root = build(gc);
+        uint64_t best_ns = UINT64_MAX;
+        for (int i = 0; i < 4; ++i) {
+            gc.check_in(root);
+            bench::stopwatch_t timer;
+            gc.collect();
+            const uint64_t ns = timer.elapsed_ns();
+            best_ns = ns < best_ns ? ns : best_ns;
+        }
+        return double(best_ns) / 1000.0;
+    }
+
+    virtual bool run() override
+    {
+        const size_t count = 1 << 20;
+        const uint32_t threads[] = {1, 2, 4};
+        for (uint32_t t : threads) {
+            const double tree_us = time_collect(t, [=](gc_t &gc) {
+                return build_tree(gc, count, 0);
+            });
+            const double list_us = time_collect(t, [=](gc_t &gc) {
+                return build_list(gc, count);
+            });
+            const double dag_us = time_collect(t, [=](gc_t &gc) {
+                random_t random(0x5678);
+                return build_dag(gc, count, random);
+            });
+            printf("  %d threads: tree %8.1f us, list %8.1f us, dag %8.1f us\n",
+                int(t), tree_us, list_us, dag_us);
+        }
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 4> reg_test = {
+    test_lib::register_t::test<bench_gc_collect_t>(),
+    test_lib::register_t::test<bench_gc_step_t>(),
+    test_lib::register_t::test<bench_gc_minor_t>(),
+    test_lib::register_t::test<bench_gc_mark_t>()
+};
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <vector>
+#include "bench.h"
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/jobs.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+namespace {
+uint32_t bench_workers()
+{
+    return std::max<uint32_t>(job_pool_t::hardware_workers(), 3);
+}
+
+// a little floating point work per index
+float busy_work(size_t i)
+{
+    float x = float(i);
+    for (int j = 0; j < 16; ++j) {
+        x = std::sqrt(x * 1.0001f + 1.f);
+    }
+    return x;
+}
+} // namespace {}
+
+// how many small jobs per second the pool can push through
+struct bench_jobs_throughput_t : public test_t {
+
+    bench_jobs_throughput_t()
+        : test_t("bench_jobs_throughput_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        const size_t jobs = 1 << 18;
+        job_pool_t pool(bench_workers());
+        std::atomic<uint64_t> sum(0);
+
+        bench::stopwatch_t timer;
+        job_counter_t counter;
+        for (size_t i = 0; i < jobs; ++i) {
+            pool.run([&sum]() { sum.fetch_add(1, std::memory_order_relaxed); },
+                &counter);
+        }
+        pool.wait(counter);
+        const double run_ns = double(timer.elapsed_ns());
+
+        // jobs spawned from inside the pool go to the workers own deques
+        sum.store(0);
+        timer.reset();
+        job_counter_t outer;
+        for (size_t i = 0; i < 64; ++i) {
+            pool.run([&]() {
+                job_counter_t inner;
+                for (size_t j = 0; j < jobs / 64; ++j) {
+                    pool.run([&sum]() {
+                        sum.fetch_add(1, std::memory_order_relaxed);
+                    }, &inner);
+                }
+                pool.wait(inner);
+            }, &outer);
+        }
+        pool.wait(outer);
+        const double spawn_ns = double(timer.elapsed_ns());
+
+        printf("  workers:  %u\n", pool.workers());
+        printf("  external: %.2f M jobs/s\n", 1000.0 * jobs / run_ns);
+        printf("  internal: %.2f M jobs/s\n", 1000.0 * jobs / spawn_ns);
+        return true;
+    }
+};
+
+// parallel_for against a plain loop over the same work
+struct bench_jobs_parallel_for_t : public test_t {
+
+    bench_jobs_parallel_for_t()
+        : test_t("bench_jobs_parallel_for_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        const size_t count = 1 << 20;
+        std::vector<float> out(count);
+        job_pool_t pool(bench_workers());
+
+        bench::stopwatch_t timer;
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = busy_work(i);
+        }
+        const double serial_ns = double(timer.elapsed_ns());
+
+        for (size_t grain : {256, 4096, 65536}) {
+            timer.reset();
+            pool.parallel_for(count, grain, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    out[i] = busy_work(i);
+                }
+            });
+            const double ns = double(timer.elapsed_ns());
+            printf("  grain %5u: %.2f ms (serial %.2f ms, %.2fx)\n",
+                uint32_t(grain), ns / 1e6, serial_ns / 1e6, serial_ns / ns);
+        }
+        return true;
+    }
+};
+
+// time from submitting a job until it starts running on a worker, both
+// with workers spinning and after they have gone to sleep
+struct bench_jobs_latency_t : public test_t {
+
+    bench_jobs_latency_t()
+        : test_t("bench_jobs_latency_t")
+    {
+    }
+
+    void measure(job_pool_t& pool, bool idle, const char* name)
+    {
+        const size_t samples = 1000;
+        std::vector<double> latency;
+        for (size_t i = 0; i < samples; ++i) {
+            if (idle) {
+                // let the workers run out of spins and sleep
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            std::atomic<uint64_t> start_ns(0);
+            bench::stopwatch_t timer;
+            job_counter_t counter;
+            pool.run([&]() {
+                start_ns.store(timer.elapsed_ns());
+            }, &counter);
+            // don't help, so the job has to be picked up by a worker
+            while (!counter.done()) {
+                yield();
+            }
+            pool.wait(counter);
+            latency.push_back(double(start_ns.load()) / 1000.0);
+        }
+        std::sort(latency.begin(), latency.end());
+        printf("  %s: median %.1f us, p99 %.1f us\n",
+            name, latency[samples / 2], latency[samples * 99 / 100]);
+    }
+
+    virtual bool run() override
+    {
+        job_pool_t pool(bench_workers());
+        measure(pool, false, "busy ");
+        measure(pool, true, "sleep");
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 3> reg_test = {
+    test_lib::register_t::test<bench_jobs_throughput_t>(),
+    test_lib::register_t::test<bench_jobs_parallel_for_t>(),
+    test_lib::register_t::test<bench_jobs_latency_t>()
+};
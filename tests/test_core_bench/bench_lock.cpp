@@ -0,0 +1,64 @@
+#include <array>
+#include <thread>
+#include <vector>
+#include "bench.h"
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/thread.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+namespace {
+// threads take the lock in a loop and do a little work inside it
+template <typename lock_t>
+void contend(const char* name, uint32_t threads, uint32_t work)
+{
+    const uint32_t count = 100000 / threads;
+    lock_t lock;
+    volatile uint64_t value = 0;
+    bench::stopwatch_t timer;
+    std::vector<std::thread> thread;
+    for (uint32_t i = 0; i < threads; ++i) {
+        thread.emplace_back([&]() {
+            for (uint32_t j = 0; j < count; ++j) {
+                scope_lock_t<lock_t> guard(lock);
+                for (uint32_t k = 0; k < work; ++k) {
+                    value = value + 1;
+                }
+            }
+        });
+    }
+    for (std::thread& t : thread) {
+        t.join();
+    }
+    const double ns = double(timer.elapsed_ns());
+    printf("  %-7s %u threads, work %3u: %6.1f ns/acquire\n",
+        name, threads, work, ns / double(count * threads));
+}
+} // namespace {}
+
+// acquire cost of each lock type uncontended and under contention
+struct bench_lock_contend_t : public test_t {
+
+    bench_lock_contend_t()
+        : test_t("bench_lock_contend_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        for (uint32_t threads : {1, 4}) {
+            for (uint32_t work : {0, 100}) {
+                contend<spinlock_t>("spin", threads, work);
+                contend<ticket_lock_t>("ticket", threads, work);
+                contend<mcs_lock_t>("mcs", threads, work);
+                contend<futex_lock_t>("futex", threads, work);
+            }
+        }
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 1> reg_test = {
+    test_lib::register_t::test<bench_lock_contend_t>()
+};
@@ -0,0 +1,154 @@
+#include <array>
+#include "bench.h"
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/objects.h"
+#include "../../framework_core/random.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+namespace {
+enum {
+    e_bench_obj_a,
+    e_bench_obj_b,
+};
+
+template <object_type_t id_t>
+struct bench_obj_t : object_ex_t<id_t, bench_obj_t<id_t>,
+                                 object_pool_t<bench_obj_t<id_t>, 1024> > {
+
+    bench_obj_t(object_service_t)
+    {
+    }
+
+    void kill()
+    {
+        object_t::destroy();
+    }
+};
+
+typedef bench_obj_t<e_bench_obj_a> obj_a_t;
+typedef bench_obj_t<e_bench_obj_b> obj_b_t;
+} // namespace {}
+
+// measure collect() as the object count grows while a fixed fraction
+// of objects churns every frame.  cost per object should stay flat.
+struct bench_object_collect_t : public test_t {
+
+    bench_object_collect_t()
+        : test_t("bench_object_collect_t")
+    {
+    }
+
+    double run_size(const size_t count)
+    {
+        random_t random(0x1234);
+        object_factory_t factory(nullptr);
+        factory.add_creator<obj_a_t>();
+        factory.add_creator<obj_b_t>();
+
+        std::vector<object_ref_t> live;
+        live.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            live.push_back((i & 1) ? factory.create<obj_a_t>()
+                                   : factory.create<obj_b_t>());
+        }
+        factory.tick();
+
+        const size_t frames = 32;
+        const size_t churn = count / 10;
+        uint64_t total_ns = 0;
+
+        for (size_t f = 0; f < frames; ++f) {
+            // kill a random tenth of the population
+            for (size_t i = 0; i < churn; ++i) {
+                const size_t index = random.rand_range<size_t>(0, live.size());
+                object_ref_t& ref = live[index];
+                static_cast<obj_a_t&>(ref.get()).kill();
+                ref = (i & 1) ? factory.create<obj_a_t>()
+                              : factory.create<obj_b_t>();
+            }
+            factory.tick();
+            bench::stopwatch_t timer;
+            factory.collect();
+            total_ns += timer.elapsed_ns();
+        }
+        return double(total_ns) / double(frames * count);
+    }
+
+    virtual bool run() override
+    {
+        static const std::array<size_t, 4> sizes = {{
+            12500, 25000, 50000, 100000 }};
+        for (const size_t size : sizes) {
+            const double ns = run_size(size);
+            printf("  collect %6d objects: %.2f ns/object\n", int(size), ns);
+        }
+        return true;
+    }
+};
+
+namespace {
+template <object_type_t id_t>
+struct tick_obj_t : object_ex_t<id_t, tick_obj_t<id_t>,
+                                object_pool_t<tick_obj_t<id_t>, 1024> > {
+
+    tick_obj_t(object_service_t)
+        : value_(0)
+    {
+    }
+
+    virtual void tick() override
+    {
+        value_ += id_t + 1;
+    }
+
+    uint32_t value_;
+};
+} // namespace {}
+
+// compare per object virtual ticks against type grouped batch ticks for
+// a population of interleaved types.
+struct bench_object_tick_t : public test_t {
+
+    bench_object_tick_t()
+        : test_t("bench_object_tick_t")
+    {
+    }
+
+    double run_mode(bool grouped)
+    {
+        object_factory_t factory(nullptr);
+        factory.add_creator<tick_obj_t<0> >();
+        factory.add_creator<tick_obj_t<1> >();
+        factory.add_creator<tick_obj_t<2> >();
+        factory.add_creator<tick_obj_t<3> >();
+        factory.set_grouped(grouped);
+
+        random_t random(0x4321);
+        const size_t count = 100000;
+        for (size_t i = 0; i < count; ++i) {
+            factory.create(object_type_t(random.rand_range<uint32_t>(0, 4)));
+        }
+        factory.tick();
+
+        const size_t frames = 64;
+        bench::stopwatch_t timer;
+        for (size_t f = 0; f < frames; ++f) {
+            factory.tick();
+        }
+        return double(timer.elapsed_ns()) / double(frames * count);
+    }
+
+    virtual bool run() override
+    {
+        printf("  tick virtual: %.2f ns/object\n", run_mode(false));
+        printf("  tick grouped: %.2f ns/object\n", run_mode(true));
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 2> reg_test = {
+    test_lib::register_t::test<bench_object_collect_t>(),
+    test_lib::register_t::test<bench_object_tick_t>()
+};
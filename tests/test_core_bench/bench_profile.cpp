@@ -0,0 +1,54 @@
+#include <array>
+#include "bench.h"
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/profile.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+// cost of recording a zone and a counter, and of gathering a frame
+struct bench_profile_zone_t : public test_t {
+
+    bench_profile_zone_t()
+        : test_t("bench_profile_zone_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        const uint32_t count = 1 << 20;
+        profiler_t& prof = profiler_t::inst();
+        prof.clear();
+
+        bench::stopwatch_t timer;
+        for (uint32_t i = 0; i < count; ++i) {
+            profile_zone_t zone("bench.zone");
+        }
+        const double zone_ns = double(timer.elapsed_ns()) / count;
+
+        timer.reset();
+        for (uint32_t i = 0; i < count; ++i) {
+            profile_counter("bench.counter", i);
+        }
+        const double counter_ns = double(timer.elapsed_ns()) / count;
+
+        // a frame with a realistic number of zones
+        prof.frame();
+        for (uint32_t i = 0; i < 2000; ++i) {
+            profile_zone_t zone((i & 1) ? "bench.a" : "bench.b");
+        }
+        timer.reset();
+        prof.frame();
+        const double frame_us = timer.elapsed_us();
+
+        prof.clear();
+        printf("  zone:    %.1f ns\n", zone_ns);
+        printf("  counter: %.1f ns\n", counter_ns);
+        printf("  frame:   %.1f us for 2000 zones\n", frame_us);
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 1> reg_test = {
+    test_lib::register_t::test<bench_profile_zone_t>()
+};
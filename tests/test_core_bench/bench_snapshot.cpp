@@ -0,0 +1,115 @@
+#include <array>
+#include "bench.h"
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/objects.h"
+#include "../../framework_core/random.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+namespace {
+enum {
+    e_snap_obj_t,
+};
+
+struct snap_obj_t : object_ex_t<e_snap_obj_t, snap_obj_t,
+                                object_pool_t<snap_obj_t, 1024> > {
+
+    snap_obj_t(object_service_t)
+        : object_ex_t()
+    {
+        memset(state_, 0, sizeof(state_));
+    }
+
+    void kill()
+    {
+        destroy();
+    }
+
+    virtual void tick() override
+    {
+        state_[0] += 1.f;
+    }
+
+    virtual void save(snapshot_t& out) const override
+    {
+        out.write(state_);
+    }
+
+    virtual void load(snapshot_reader_t& in) override
+    {
+        in.read(state_);
+    }
+
+    // position, velocity, health etc
+    float state_[8];
+};
+} // namespace {}
+
+// time snapshot and restore of a factory holding 5k objects.  the target
+// is eight of each well within a 16ms frame.
+struct bench_snapshot_t : public test_t {
+
+    bench_snapshot_t()
+        : test_t("bench_snapshot_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        const size_t count = 5000;
+        const size_t rounds = 200;
+
+        random_t random(0x9876);
+        object_factory_t factory(nullptr);
+        factory.add_creator<snap_obj_t>();
+        std::vector<object_handle_t> handles;
+        for (size_t i = 0; i < count; ++i) {
+            handles.push_back(factory.create<snap_obj_t>()->handle());
+        }
+        factory.tick();
+
+        snapshot_t snap;
+        factory.snapshot(snap);
+
+        uint64_t save_ns = 0, load_ns = 0, worst_ns = 0;
+        for (size_t r = 0; r < rounds; ++r) {
+            bench::stopwatch_t timer;
+            factory.snapshot(snap);
+            save_ns += timer.elapsed_ns();
+
+            // diverge a little so restore has work to do
+            for (int i = 0; i < 16; ++i) {
+                const size_t index = random.rand_range<size_t>(0, count);
+                if (snap_obj_t* obj = factory.resolve<snap_obj_t>(handles[index])) {
+                    obj->kill();
+                }
+                factory.create<snap_obj_t>();
+            }
+            factory.tick();
+            factory.collect();
+
+            timer.reset();
+            if (!factory.restore(snap)) {
+                return false;
+            }
+            const uint64_t ns = timer.elapsed_ns();
+            load_ns += ns;
+            worst_ns = ns > worst_ns ? ns : worst_ns;
+            factory.collect();
+        }
+        const double save_us = double(save_ns) / (1000.0 * rounds);
+        const double load_us = double(load_ns) / (1000.0 * rounds);
+        printf("  snapshot %d objects: %.1f us (%d bytes)\n",
+            int(count), save_us, int(snap.size()));
+        printf("  restore  %d objects: %.1f us (worst %.1f us)\n",
+            int(count), load_us, double(worst_ns) / 1000.0);
+        printf("  8x snapshot+restore: %.2f ms\n",
+            8.0 * (save_us + load_us) / 1000.0);
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 1> reg_test = {
+    test_lib::register_t::test<bench_snapshot_t>()
+};
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "bench.h"
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/spsc.h"
+#include "../../framework_core/thread.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+namespace {
+// the queue the audio sources used before, for comparison
+template <typename type_t, size_t>
+struct locked_queue_t {
+
+    bool push(const type_t& in)
+    {
+        scope_lock_t<spinlock_t> guard(lock_);
+        queue_.push(in);
+        return true;
+    }
+
+    bool pop(type_t& out)
+    {
+        scope_lock_t<spinlock_t> guard(lock_);
+        if (queue_.empty()) {
+            return false;
+        }
+        out = queue_.front();
+        queue_.pop();
+        return true;
+    }
+
+protected:
+    spinlock_t lock_;
+    std::queue<type_t> queue_;
+};
+
+struct command_t {
+    uint64_t sent_ns_;
+    uint32_t value_;
+};
+
+// a game thread posts commands while an audio thread drains them every
+// millisecond.  other threads burn cpu to load the machine.  reports how
+// long each drain took on the audio thread and the time from post to pop.
+template <template <typename, size_t> class queue_t>
+void audio_load(const char* name)
+{
+    const uint32_t commands = 20000;
+    const uint32_t load_threads = 3;
+    queue_t<command_t, 1024> queue;
+    bench::stopwatch_t clock;
+    std::atomic<bool> done(false);
+
+    std::vector<std::thread> load;
+    for (uint32_t i = 0; i < load_threads; ++i) {
+        load.emplace_back([&]() {
+            volatile uint64_t x = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                x = x + 1;
+            }
+        });
+    }
+
+    std::vector<double> drain_us;
+    std::vector<double> latency_us;
+    std::thread audio([&]() {
+        uint32_t received = 0;
+        while (received < commands) {
+            const uint64_t start = clock.elapsed_ns();
+            command_t c;
+            while (queue.pop(c)) {
+                latency_us.push_back(double(clock.elapsed_ns() - c.sent_ns_) / 1000.0);
+                ++received;
+            }
+            drain_us.push_back(double(clock.elapsed_ns() - start) / 1000.0);
+            std::this_thread::sleep_for(std::chrono::microseconds(1000));
+        }
+    });
+
+    for (uint32_t i = 0; i < commands; ++i) {
+        command_t c = { clock.elapsed_ns(), i };
+        while (!queue.push(c)) {
+            yield();
+        }
+        if ((i & 15) == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    audio.join();
+    done.store(true);
+    for (std::thread& t : load) {
+        t.join();
+    }
+
+    std::sort(drain_us.begin(), drain_us.end());
+    std::sort(latency_us.begin(), latency_us.end());
+    printf("  %-6s drain: median %6.1f us, max %8.1f us | latency: median %7.1f us, p99 %8.1f us\n",
+        name,
+        drain_us[drain_us.size() / 2], drain_us.back(),
+        latency_us[latency_us.size() / 2],
+        latency_us[latency_us.size() * 99 / 100]);
+}
+} // namespace {}
+
+struct bench_spsc_audio_t : public test_t {
+
+    bench_spsc_audio_t()
+        : test_t("bench_spsc_audio_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        audio_load<locked_queue_t>("locked");
+        audio_load<spsc_ring_t>("spsc");
+        return true;
+    }
+};
+
+// raw hand off rate between two threads
+struct bench_spsc_throughput_t : public test_t {
+
+    bench_spsc_throughput_t()
+        : test_t("bench_spsc_throughput_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        const uint64_t count = 1 << 22;
+        spsc_ring_t<uint64_t, 1024> ring;
+        bench::stopwatch_t timer;
+        std::thread producer([&]() {
+            for (uint64_t i = 0; i < count; ++i) {
+                while (!ring.push(i)) {
+                    yield();
+                }
+            }
+        });
+        uint64_t sum = 0, v = 0;
+        for (uint64_t i = 0; i < count;) {
+            if (ring.pop(v)) {
+                sum += v;
+                ++i;
+            } else {
+                yield();
+            }
+        }
+        producer.join();
+        const double ns = double(timer.elapsed_ns());
+        printf("  %.2f M items/s (checksum %llu)\n",
+            1000.0 * count / ns, (unsigned long long)sum);
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 2> reg_test = {
+    test_lib::register_t::test<bench_spsc_audio_t>(),
+    test_lib::register_t::test<bench_spsc_throughput_t>()
+};
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#include "bench.h"
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/timer.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+namespace {
+uint64_t now_ns()
+{
+    typedef std::chrono::steady_clock clock_t;
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock_t::now().time_since_epoch()).count());
+}
+
+// pace 60Hz frames and report how far the frame intervals stray from
+// the ideal 16.67ms
+void pace(const char* name, uint64_t spin_ns)
+{
+    const uint32_t frames = 120;
+    frame_scheduler_t<uint64_t> sched(now_ns, 1000000000ull);
+    sched.spin_ = spin_ns;
+    sched.set_frame_rate(60);
+    std::vector<double> error_us;
+    uint64_t last = now_ns();
+    for (uint32_t i = 0; i < frames; ++i) {
+        sched.wait();
+        const uint64_t now = now_ns();
+        error_us.push_back(std::abs(double(now - last) - 1e9 / 60.0) / 1000.0);
+        last = now;
+    }
+    std::sort(error_us.begin(), error_us.end());
+    printf("  %-6s median %7.1f us, p90 %7.1f us, max %7.1f us\n",
+        name, error_us[frames / 2], error_us[frames * 9 / 10], error_us.back());
+}
+} // namespace {}
+
+// frame interval jitter with pure sleeping against sleep then spin
+struct bench_timer_pace_t : public test_t {
+
+    bench_timer_pace_t()
+        : test_t("bench_timer_pace_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        pace("sleep", 0);
+        pace("hybrid", 2000000);
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 1> reg_test = {
+    test_lib::register_t::test<bench_timer_pace_t>()
+};
@@ -0,0 +1,77 @@
+#include <array>
+#include <vector>
+#include "bench.h"
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/random.h"
+#include "../../framework_core/wheel.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+// cost per timer of scheduling, cancelling and firing, against polling a
+// countdown per timer every tick
+struct bench_wheel_t : public test_t {
+
+    bench_wheel_t()
+        : test_t("bench_wheel_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        const uint32_t count = 1 << 16;
+        const uint32_t ticks = 1024;
+        random_t rand(1234);
+        std::vector<uint32_t> delay(count);
+        for (uint32_t& d : delay) {
+            d = 1 + rand.rand() % ticks;
+        }
+
+        timer_wheel_t wheel;
+        std::vector<timer_handle_t> handle(count);
+        uint64_t fired = 0;
+        bench::stopwatch_t timer;
+        for (uint32_t i = 0; i < count; ++i) {
+            handle[i] = wheel.schedule(delay[i], [&fired]() { ++fired; });
+        }
+        const double schedule_ns = double(timer.elapsed_ns()) / count;
+
+        // cancel every other timer
+        timer.reset();
+        for (uint32_t i = 0; i < count; i += 2) {
+            wheel.cancel(handle[i]);
+        }
+        const double cancel_ns = double(timer.elapsed_ns()) / (count / 2);
+
+        timer.reset();
+        wheel.advance(ticks);
+        const double fire_ns = double(timer.elapsed_ns()) / (count / 2);
+
+        // the same workload as countdowns decremented each tick
+        std::vector<int32_t> countdown(delay.begin(), delay.end());
+        for (uint32_t i = 0; i < count; i += 2) {
+            countdown[i] = 0;
+        }
+        uint64_t polled = 0;
+        timer.reset();
+        for (uint32_t t = 0; t < ticks; ++t) {
+            for (int32_t& c : countdown) {
+                if (c > 0 && --c == 0) {
+                    ++polled;
+                }
+            }
+        }
+        const double poll_ns = double(timer.elapsed_ns()) / (count / 2);
+
+        printf("  schedule: %.1f ns\n", schedule_ns);
+        printf("  cancel:   %.1f ns\n", cancel_ns);
+        printf("  fire:     %.1f ns (%u fired)\n", fire_ns, uint32_t(fired));
+        printf("  polling:  %.1f ns per timer (%u fired)\n", poll_ns,
+            uint32_t(polled));
+        return fired == polled;
+    }
+};
+
+static std::array<test_lib::register_t*, 1> reg_test = {
+    test_lib::register_t::test<bench_wheel_t>()
+};
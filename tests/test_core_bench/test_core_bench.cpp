@@ -0,0 +1,6 @@
+#include <array>
+#include "../test_lib/test_lib.h"
+
+int main() {
+    return test_lib::executor_t::inst().run();
+}
@@ -1,4 +1,5 @@
 #include <array>
+#include <vector>
 #include "../test_lib/test_lib.h"
 
 #include "../../framework_core/anim.h"
@@ -60,6 +61,156 @@ struct test_anim_t: public test_t {
     }
 };
 
-static std::array<test_lib::register_t*, 1> reg_test = {
-    test_lib::register_t::test<test_anim_t>()
+namespace {
+bool same_rect(const tengu::recti_t& a, const tengu::recti_t& b)
+{
+    return a.x0 == b.x0 && a.y0 == b.y0 && a.x1 == b.x1 && a.y1 == b.y1;
+}
+
+// sequences covering loops, jumps, pops, holds and trailing opcodes
+struct anim_fixture_t {
+
+    anim_fixture_t()
+        : sheet_(128, 128)
+        , walk_("walk", tengu::anim::sequence_t::e_end_loop)
+        , impact_("impact", tengu::anim::sequence_t::e_end_pop)
+        , intro_("intro", tengu::anim::sequence_t::e_end_hold)
+        , idle_("idle", tengu::anim::sequence_t::e_end_hold)
+    {
+        sheet_.add_grid(32, 32);
+        walk_.op_interval(3).op_event(1).op_frame(0).op_delay(2).op_frame(1)
+            .op_hotspot(4, 5).op_event(2).op_frame(2).op_delay(4)
+            .op_frame(3).op_offset(1, 2);
+        impact_.op_interval(2).op_event(3).op_frame(4).op_frame(5)
+            .op_frame(6).op_event(4);
+        // an intro which then loops its second half via a jump
+        intro_.op_interval(5).op_frame(7).op_event(5).op_frame(8)
+            .op_interval(2).op_frame(9).op_event(6).op_frame(10)
+            .op_delay(1).op_jmp(4);
+        idle_.op_delay(3).op_frame(11).op_interval(6).op_frame(12)
+            .op_hotspot(7, 7).op_event(7);
+    }
+
+    tengu::anim::sheet_t sheet_;
+    tengu::anim::sequence_t walk_, impact_, intro_, idle_;
+};
+} // namespace {}
+
+// system_t plays sequences exactly as controller_t does
+struct test_anim_2_t: public test_t {
+
+    test_anim_2_t()
+        : test_t("test_anim_2_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        anim_fixture_t f;
+        anim::system_t sys;
+        const anim::sequence_t* seq[] = { &f.walk_, &f.intro_, &f.idle_ };
+        std::vector<anim::controller_t> control(3);
+        std::vector<uint32_t> id;
+        for (int i = 0; i < 3; ++i) {
+            control[i].set_sheet(&f.sheet_);
+            control[i].push_sequence(seq[i]);
+            id.push_back(sys.create(&f.sheet_));
+            sys.push_sequence(id[i], sys.compile(*seq[i]));
+        }
+        const uint32_t impact = sys.compile(f.impact_);
+        const int32_t delta[] = { 1, 1, 2, 1, 3, 7, 1, 1, 5, 2, 0, 11 };
+        for (int t = 0; t < 300; ++t) {
+            if (t % 50 == 20) {
+                // an impact pushed over whatever is playing, popping itself
+                control[t % 3].push_sequence(&f.impact_);
+                sys.push_sequence(id[t % 3], impact);
+            }
+            const int32_t d = delta[t % 12];
+            sys.tick(d);
+            for (int i = 0; i < 3; ++i) {
+                control[i].tick(d);
+                recti_t a, b;
+                TEST_ASSERT(control[i].get_frame(a) == sys.get_frame(id[i], b));
+                TEST_ASSERT(same_rect(a, b));
+                int32_t ax, ay, bx, by;
+                control[i].get_hotspot(ax, ay);
+                sys.get_hotspot(id[i], bx, by);
+                TEST_ASSERT(ax == bx && ay == by);
+                control[i].get_offset(ax, ay);
+                sys.get_offset(id[i], bx, by);
+                TEST_ASSERT(ax == bx && ay == by);
+                // events in the order they were raised
+                std::vector<int32_t> expect, got;
+                uint32_t e;
+                while (control[i].get_event(e)) {
+                    expect.push_back(int32_t(e));
+                }
+                for (const anim::system_t::fired_t& fired : sys.events()) {
+                    if (fired.controller_ == id[i]) {
+                        got.push_back(fired.event_);
+                    }
+                }
+                TEST_ASSERT(expect == got);
+            }
+        }
+        // pushing onto a full stack is refused and leaves the neighbouring
+        // controllers alone
+        recti_t before, after;
+        TEST_ASSERT(sys.get_frame(id[1], before));
+        uint32_t pushed = 0;
+        while (sys.push_sequence(id[0], impact)) {
+            ++pushed;
+        }
+        TEST_ASSERT(pushed < anim::system_t::c_max_depth);
+        TEST_ASSERT(!sys.push_sequence(id[0], impact));
+        TEST_ASSERT(sys.get_frame(id[1], after) && same_rect(before, after));
+        for (uint32_t i = 0; i < anim::system_t::c_max_depth; ++i) {
+            sys.pop_sequence(id[0]);
+        }
+        TEST_ASSERT(!sys.get_frame(id[0], after));
+        TEST_ASSERT(sys.push_sequence(id[0], impact));
+        return true;
+    }
+};
+
+// one large step lands in the same place as many small ones
+struct test_anim_3_t: public test_t {
+
+    test_anim_3_t()
+        : test_t("test_anim_3_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        anim_fixture_t f;
+        const anim::sequence_t* seq[] = { &f.walk_, &f.intro_, &f.idle_ };
+        for (const anim::sequence_t* s : seq) {
+            for (int32_t total : { 1, 17, 1000, 123457 }) {
+                anim::system_t fast, slow;
+                const uint32_t a_id = fast.create(&f.sheet_);
+                const uint32_t b_id = slow.create(&f.sheet_);
+                fast.push_sequence(a_id, fast.compile(*s));
+                slow.push_sequence(b_id, slow.compile(*s));
+                fast.tick(total);
+                const size_t fast_events = fast.events().size();
+                size_t slow_events = 0;
+                for (int32_t i = 0; i < total; ++i) {
+                    slow.tick(1);
+                    slow_events += slow.events().size();
+                }
+                recti_t a, b;
+                TEST_ASSERT(fast.get_frame(a_id, a) && slow.get_frame(b_id, b));
+                TEST_ASSERT(same_rect(a, b));
+                TEST_ASSERT(fast_events == slow_events);
+            }
+        }
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 3> reg_test = {
+    test_lib::register_t::test<test_anim_t>(),
+    test_lib::register_t::test<test_anim_2_t>(),
+    test_lib::register_t::test<test_anim_3_t>()
 };
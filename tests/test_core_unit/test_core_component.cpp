@@ -0,0 +1,128 @@
+#include <array>
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/component.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+namespace {
+enum {
+    e_type_entity,
+};
+
+struct entity_t : public object_ex_t<e_type_entity, entity_t> {
+    entity_t(object_service_t)
+        : object_ex_t()
+    {
+    }
+
+    void kill() {
+        destroy();
+    }
+};
+
+struct position_t {
+    float x_, y_;
+};
+
+struct velocity_t {
+    float dx_, dy_;
+};
+} // namespace {}
+
+struct test_component_1_t: public test_t {
+
+    test_component_1_t()
+        : test_t("test_component_1_t")
+    {
+    }
+
+    virtual bool run() override {
+        object_factory_t factory(nullptr);
+        factory.add_creator<entity_t>();
+
+        component_store_t<position_t> pos;
+        component_store_t<velocity_t> vel;
+
+        std::vector<object_handle_t> ents;
+        for (int i = 0; i < 64; ++i) {
+            const object_handle_t h = factory.create<entity_t>()->handle();
+            ents.push_back(h);
+            pos.add(h, position_t{float(i), 0.f});
+            // only every other entity moves
+            if ((i & 1) == 0) {
+                vel.add(h, velocity_t{1.f, 2.f});
+            }
+        }
+        factory.tick();
+        TEST_ASSERT(pos.size() == 64 && vel.size() == 32);
+
+        // adding again returns the existing component
+        TEST_ASSERT(&pos.add(ents[3]) == pos.get(ents[3]));
+        TEST_ASSERT(pos.size() == 64);
+
+        int visited = 0;
+        component_each([&](object_handle_t, velocity_t& v, position_t& p) {
+            p.x_ += v.dx_;
+            p.y_ += v.dy_;
+            ++visited;
+        }, vel, pos);
+        TEST_ASSERT(visited == 32);
+        for (int i = 0; i < 64; ++i) {
+            const position_t* p = pos.get(ents[i]);
+            TEST_ASSERT(p);
+            TEST_ASSERT(p->x_ == float(i) + ((i & 1) ? 0.f : 1.f));
+        }
+
+        // aligned stores walk in lockstep and give the same answer
+        pos.align(vel);
+        for (size_t i = 0; i < vel.size(); ++i) {
+            TEST_ASSERT(pos.handles()[i] == vel.handles()[i]);
+        }
+        visited = 0;
+        component_each([&](object_handle_t, velocity_t& v, position_t& p) {
+            p.y_ += v.dy_;
+            ++visited;
+        }, vel, pos);
+        TEST_ASSERT(visited == 32);
+        TEST_ASSERT(pos.get(ents[0])->y_ == 4.f);
+        TEST_ASSERT(pos.get(ents[1])->y_ == 0.f);
+
+        // removal keeps the rest intact
+        TEST_ASSERT(vel.remove(ents[0]));
+        TEST_ASSERT(!vel.remove(ents[0]));
+        TEST_ASSERT(!vel.has(ents[0]) && vel.size() == 31);
+        TEST_ASSERT(vel.get(ents[2]) && vel.get(ents[2])->dx_ == 1.f);
+
+        // destroyed objects are pruned and their stale handles miss
+        factory.resolve<entity_t>(ents[4])->kill();
+        factory.collect();
+        pos.prune(factory);
+        vel.prune(factory);
+        TEST_ASSERT(!pos.has(ents[4]) && !vel.has(ents[4]));
+        TEST_ASSERT(pos.size() == 63 && vel.size() == 30);
+
+        // a new object reusing the slot does not see old components.  freed
+        // slots are queued, so churn objects until it comes round again.
+        object_handle_t fresh;
+        for (uint32_t i = 0; i < object_factory_t::c_min_free * 2; ++i) {
+            fresh = factory.create<entity_t>()->handle();
+            if (fresh.index() == ents[4].index()) {
+                break;
+            }
+            factory.tick();
+            factory.resolve<entity_t>(fresh)->kill();
+            factory.collect();
+        }
+        TEST_ASSERT(fresh.index() == ents[4].index());
+        TEST_ASSERT(!pos.has(fresh));
+        pos.add(fresh, position_t{-1.f, -1.f});
+        TEST_ASSERT(!pos.has(ents[4]) && pos.get(fresh)->x_ == -1.f);
+
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 1> reg_test = {
+    test_lib::register_t::test<test_component_1_t>()
+};
@@ -1,4 +1,8 @@
 #include <array>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
 #include "../test_lib/test_lib.h"
 #include "../../framework_core/event.h"
 
@@ -81,14 +85,389 @@ struct test_event_t: public test_t {
         TEST_ASSERT(global.has(3));
         TEST_ASSERT(global.has(5));
 
-        // <---- ---- ---- ---- ---- ---- ---- ---- ---- todo: test multiple locals / globals
+        // multiple locals and globals across two streams
+        event_stream_t other;
+        local_listener_t local2;
+        global_listener_t global2;
+        std::array<uint32_t, 2> filter2 = {3, 4};
+        stream.add<2>(&local2, filter2);
+        other.add<2>(&local2, filter2);
+        stream.add(&global2);
+        other.add(&global);
+        {
+            event_t e = {4};
+            stream.send(&e);
+            event_t f = {7};
+            other.send(&f);
+        }
+        TEST_ASSERT(local2.received_.size()==1);
+        TEST_ASSERT(local2.has(4));
+        TEST_ASSERT(global2.received_.size()==1);
+        TEST_ASSERT(global2.has(4));
+        TEST_ASSERT(global.received_.size()==6);
+        TEST_ASSERT(global.has(7));
+
+        return true;
+    }
+};
+
+struct value_event_t : public event_t {
+
+    value_event_t(event_type_t type, int value)
+        : event_t(type)
+        , value_(value)
+    {
+    }
+
+    int value_;
+};
+
+struct queue_listener_t : public event_listener_t {
+
+    queue_listener_t(event_stream_t & stream)
+        : stream_(stream)
+        , nested_(false)
+    {
+    }
+
+    virtual void recieve_event(const event_t * e) {
+        const value_event_t * v = static_cast<const value_event_t*>(e);
+        received_.push_back(v->value_);
+        // posting during dispatch is deferred to the next dispatch
+        if (e->type() == 1) {
+            stream_.post(value_event_t(9, v->value_ * 10));
+            // and dispatching again from here is refused
+            nested_ |= stream_.dispatch();
+        }
+    }
+
+    event_stream_t & stream_;
+    std::vector<int> received_;
+    bool nested_;
+};
+
+struct test_event_queue_t: public test_t {
+
+    test_event_queue_t()
+        : test_t("test_event_queue_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        event_stream_t stream;
+        queue_listener_t listener(stream);
+        stream.add(&listener);
+
+        stream.post(value_event_t(2, 1));
+        stream.post(value_event_t(1, 2));
+        stream.post(value_event_t(2, 3));
+        TEST_ASSERT(stream.queued() == 3);
+        TEST_ASSERT(listener.received_.empty());
+
+        // grouped by type, in posting order within a type
+        stream.dispatch();
+        TEST_ASSERT(listener.received_.size() == 3);
+        TEST_ASSERT(listener.received_[0] == 2);
+        TEST_ASSERT(listener.received_[1] == 1);
+        TEST_ASSERT(listener.received_[2] == 3);
+        TEST_ASSERT(stream.queued() == 1);
+        TEST_ASSERT(!listener.nested_);
+
+        stream.dispatch();
+        TEST_ASSERT(listener.received_.size() == 4);
+        TEST_ASSERT(listener.received_[3] == 20);
+        TEST_ASSERT(stream.queued() == 0);
+
+        // once warmed up a frame of events needs no new storage
+        size_t capacity = 0;
+        for (int frame = 0; frame < 4; ++frame) {
+            listener.received_.clear();
+            for (int i = 0; i < 2000; ++i) {
+                stream.post(value_event_t(2 + i % 5, i));
+            }
+            stream.dispatch();
+            TEST_ASSERT(listener.received_.size() == 2000);
+            const size_t used = stream.queue_capacity();
+            TEST_ASSERT(frame < 2 || used == capacity);
+            capacity = used;
+        }
+        return true;
+    }
+};
+
+struct producer_listener_t : public event_listener_t {
+
+    producer_listener_t()
+        : received_(0)
+        , ordered_(true)
+    {
+        last_.fill(-1);
+    }
+
+    virtual void recieve_event(const event_t * e) {
+        // each producer posts under its own type with increasing values
+        const int value = static_cast<const value_event_t*>(e)->value_;
+        int & last = last_[e->type() - 100];
+        ordered_ &= value > last;
+        last = value;
+        ++received_;
+    }
+
+    std::array<int, 8> last_;
+    uint64_t received_;
+    bool ordered_;
+};
+
+struct test_event_producers_t: public test_t {
+
+    test_event_producers_t()
+        : test_t("test_event_producers_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        const int producers = 8;
+        const int count = 50000;
+
+        event_stream_t stream;
+        producer_listener_t listener;
+        stream.add(&listener);
+
+        std::atomic<int> running(producers);
+        std::vector<std::thread> threads;
+        std::vector<event_producer_t*> handles;
+        for (int p = 0; p < producers; ++p) {
+            event_producer_t * handle = stream.add_producer();
+            handles.push_back(handle);
+            threads.emplace_back([handle, p, &running]() {
+                for (int i = 0; i < count; ++i) {
+                    handle->post(value_event_t(100 + p, i));
+                }
+                running.fetch_sub(1);
+            });
+        }
+        // the owning thread keeps dispatching while producers run
+        while (running.load() > 0) {
+            stream.dispatch();
+        }
+        for (std::thread & t : threads) {
+            t.join();
+        }
+        stream.dispatch();
+        stream.dispatch();
+
+        uint64_t posted = 0;
+        for (event_producer_t * handle : handles) {
+            TEST_ASSERT(handle->posted() + handle->dropped() == count);
+            posted += handle->posted();
+        }
+        TEST_ASSERT(posted > 0);
+        TEST_ASSERT(listener.received_ == posted);
+        TEST_ASSERT(listener.ordered_);
+        return true;
+    }
+};
+
+struct remove_listener_t : public event_listener_t {
+
+    remove_listener_t(event_stream_t & stream)
+        : stream_(stream)
+        , other_(nullptr)
+        , added_(nullptr)
+        , received_(0)
+    {
+    }
+
+    virtual void recieve_event(const event_t *) {
+        ++received_;
+        // unregister ourself and another listener mid send
+        stream_.remove(this);
+        if (other_) {
+            stream_.remove(other_);
+        }
+        if (added_) {
+            stream_.add(added_);
+        }
+    }
+
+    event_stream_t & stream_;
+    event_listener_t * other_;
+    event_listener_t * added_;
+    int received_;
+};
+
+struct test_event_remove_t: public test_t {
+
+    test_event_remove_t()
+        : test_t("test_event_remove_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        event_stream_t stream;
+        remove_listener_t a(stream), b(stream), c(stream), d(stream);
+        a.other_ = &b;
+        a.added_ = &d;
+        stream.add(&a);
+        stream.add(&b);
+        stream.add(&c);
+
+        event_t e(1);
+        stream.send(&e);
+        // b was removed before it was reached, d was added during the send
+        TEST_ASSERT(a.received_ == 1);
+        TEST_ASSERT(b.received_ == 0);
+        TEST_ASSERT(c.received_ == 1);
+        TEST_ASSERT(d.received_ == 0);
+
+        // only d is left
+        stream.send(&e);
+        TEST_ASSERT(a.received_ == 1);
+        TEST_ASSERT(c.received_ == 1);
+        TEST_ASSERT(d.received_ == 1);
+        stream.send(&e);
+        TEST_ASSERT(d.received_ == 1);
+        return true;
+    }
+};
+
+enum {
+    e_damage = 200,
+    e_fire_damage,
+    e_fall_damage,
+    e_pickup,
+};
+
+struct damage_event_t : public event_t {
+
+    static event_type_t type() { return e_damage; }
+
+    damage_event_t(event_type_t type, int amount)
+        : event_t(type)
+        , amount_(amount)
+    {
+    }
+
+    int amount_;
+};
+
+struct fire_damage_event_t : public damage_event_t {
+
+    static event_type_t type() { return e_fire_damage; }
+
+    fire_damage_event_t(int amount, int heat)
+        : damage_event_t(type(), amount)
+        , heat_(heat)
+    {
+    }
+
+    int heat_;
+};
+
+struct fall_damage_event_t : public damage_event_t {
+
+    static event_type_t type() { return e_fall_damage; }
+
+    fall_damage_event_t(int amount)
+        : damage_event_t(type(), amount)
+    {
+    }
+};
+
+struct pickup_event_t : public event_t {
+
+    static event_type_t type() { return e_pickup; }
+
+    pickup_event_t()
+        : event_t(type())
+    {
+    }
+};
+
+struct damage_listener_t : public event_listener_t {
+
+    damage_listener_t()
+        : total_(0)
+        , count_(0)
+    {
+    }
+
+    virtual void recieve_event(const event_t * e) {
+        // every event in the category can be viewed as its base
+        total_ += e->cast<damage_event_t>().amount_;
+        ++count_;
+    }
+
+    int total_;
+    int count_;
+};
+
+struct test_event_category_t: public test_t {
+
+    test_event_category_t()
+        : test_t("test_event_category_t")
+    {
+    }
+
+    virtual bool run() override
+    {
+        event_registry_t & registry = event_registry_t::inst();
+        TEST_ASSERT(registry.add(e_damage));
+        TEST_ASSERT(registry.add(e_fire_damage, e_damage));
+        TEST_ASSERT(registry.add(e_fall_damage, e_damage));
+        TEST_ASSERT(registry.add(e_pickup));
+        // huge type ids are refused rather than growing the tables
+        TEST_ASSERT(!registry.add(0xfffffff0u));
+        TEST_ASSERT(!registry.add(e_pickup, 0xfffffff0u));
+        TEST_ASSERT(registry.mask(0xfffffff0u) == 0);
+
+        fire_damage_event_t fire(5, 100);
+        fall_damage_event_t fall(3);
+        damage_event_t damage(e_damage, 1);
+        pickup_event_t pickup;
+
+        // downcasts follow the hierarchy
+        TEST_ASSERT(fire.is_a<fire_damage_event_t>());
+        TEST_ASSERT(fire.is_a<damage_event_t>());
+        TEST_ASSERT(!fire.is_a<fall_damage_event_t>());
+        TEST_ASSERT(damage.is_a<damage_event_t>());
+        TEST_ASSERT(!damage.is_a<fire_damage_event_t>());
+        TEST_ASSERT(!pickup.is_a<damage_event_t>());
+        const event_t & e = fire;
+        TEST_ASSERT(e.cast<damage_event_t>().amount_ == 5);
+        TEST_ASSERT(e.cast<fire_damage_event_t>().heat_ == 100);
+
+        // one subscription covers the whole category
+        event_stream_t stream;
+        damage_listener_t listener;
+        stream.add_category(&listener, e_damage);
+        stream.send(&fire);
+        stream.send(&fall);
+        stream.send(&damage);
+        stream.send(&pickup);
+        TEST_ASSERT(listener.count_ == 3);
+        TEST_ASSERT(listener.total_ == 9);
 
-        // <---- ---- ---- ---- ---- ---- ---- ---- ---- todo: test derived event types and safe casts
+        stream.remove_category(&listener, e_damage);
+        stream.send(&fire);
+        TEST_ASSERT(listener.count_ == 3);
 
+        // and likewise skipped by filtered listeners
+        const std::array<event_type_t, 2> filter = {{ e_fall_damage, 0xfffffff0u }};
+        TEST_ASSERT(!stream.add<2>(&listener, filter));
+        stream.send(&fall);
+        TEST_ASSERT(listener.count_ == 4);
         return true;
     }
 };
 
-static std::array<test_lib::register_t*, 1> reg_test = {
-    test_lib::register_t::test<test_event_t>()
+static std::array<test_lib::register_t*, 5> reg_test = {
+    test_lib::register_t::test<test_event_t>(),
+    test_lib::register_t::test<test_event_queue_t>(),
+    test_lib::register_t::test<test_event_producers_t>(),
+    test_lib::register_t::test<test_event_remove_t>(),
+    test_lib::register_t::test<test_event_category_t>()
 };
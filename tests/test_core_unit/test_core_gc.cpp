@@ -1,4 +1,6 @@
 #include <array>
+#include <cstring>
+#include <set>
 
 #include "../../framework_core/gc.h"
 #include "../test_lib/test_lib.h"
@@ -119,7 +121,288 @@ struct test_gc_2_t : public test_t {
     }
 };
 
-static std::array<test_lib::register_t*, 2> reg_test = {
+struct big_object_t : public object_t {
+
+  big_object_t(int &r)
+    : object_t(r)
+  {
+    memset(data, 0, sizeof(data));
+  }
+
+  // too big for any of the gc size classes
+  uint8_t data[4096];
+};
+
+struct test_gc_3_t : public test_t {
+
+    test_gc_3_t()
+        : test_t("test gc 3")
+    {
+    }
+
+    bool run()
+    {
+        using namespace tengu;
+
+        int ref = 0;
+        gc_t gc;
+
+        object_t *root = gc.alloc<object_t>(ref);
+        root->a = gc.alloc<big_object_t>(ref);
+        root->a->a = gc.alloc<object_t>(ref);
+        root->b = gc.alloc<big_object_t>(ref);
+        TEST_ASSERT(ref == 4);
+
+        // drop one big and one small object
+        object_t *dead = root->a->a;
+        root->b = nullptr;
+        root->a->a = nullptr;
+        gc.check_in(root);
+        gc.collect();
+        TEST_ASSERT(ref == 2);
+        TEST_ASSERT(gc.allocs().size() == 2);
+
+        // freed arena slots are handed out again once the allocation
+        // cursor wraps around the page
+        bool reused = false;
+        for (int i = 0; i < 4096 && !reused; ++i) {
+            reused = gc.alloc<object_t>(ref) == dead;
+        }
+        TEST_ASSERT(reused);
+
+        // objects not reachable from a root are all collected
+        gc.collect();
+        TEST_ASSERT(ref == 0);
+        TEST_ASSERT(gc.allocs().empty());
+        return true;
+    }
+};
+
+struct test_gc_4_t : public test_t {
+
+    test_gc_4_t()
+        : test_t("test gc 4")
+    {
+    }
+
+    // collect the objects reachable from root
+    static std::vector<object_t*> reachable(object_t *root) {
+        std::set<object_t*> seen;
+        std::vector<object_t*> stack(1, root), out;
+        while (!stack.empty()) {
+            object_t *o = stack.back();
+            stack.pop_back();
+            if (o && seen.insert(o).second) {
+                out.push_back(o);
+                stack.push_back(o->a);
+                stack.push_back(o->b);
+            }
+        }
+        return out;
+    }
+
+    bool run()
+    {
+        using namespace tengu;
+
+        int ref = 0;
+        gc_t gc;
+
+        object_t *root = gc.alloc<object_t>(ref);
+        for (int i = 0; i < 2000; ++i) {
+            const auto &a = gc.allocs();
+            object_t *item = static_cast<object_t*>(a[rand() % a.size()]);
+            gc.write(item, item->a, gc.alloc<object_t>(ref));
+        }
+
+        // mutate the graph between very small steps of collection.  a
+        // mutator can only reach live objects so pick from those.
+        int cycles = 0;
+        while (cycles < 8) {
+            const auto live = reachable(root);
+            for (int i = 0; i < 8; ++i) {
+                object_t *x = live[rand() % live.size()];
+                object_t *y = live[rand() % live.size()];
+                switch (rand() % 3) {
+                case 0:
+                    // move a subtree somewhere else
+                    gc.write(x, x->b, y->a);
+                    gc.write(y, y->a, (object_t*)nullptr);
+                    break;
+                case 1:
+                    gc.write(x, x->a, gc.alloc<object_t>(ref));
+                    break;
+                case 2:
+                    gc.write(x, x->b, (object_t*)nullptr);
+                    break;
+                }
+            }
+            // minor collections can only run between incremental cycles
+            if (rand() % 4 == 0) {
+                gc.check_in(root);
+                TEST_ASSERT(gc.collect_minor() == (gc.phase() == gc_t::e_idle));
+            }
+            gc.check_in(root);
+            if (gc.step(1)) {
+                ++cycles;
+            }
+            // nothing reachable may have been freed
+            TEST_ASSERT(size_t(ref) == gc.allocs().size());
+            for (object_t *o : reachable(root)) {
+                TEST_ASSERT(tengu::gc_header_t::from(o)->used());
+            }
+        }
+
+        // a full cycle with no mutation leaves only what is reachable
+        gc.collect();
+        gc.check_in(root);
+        gc.collect();
+        TEST_ASSERT(size_t(ref) == reachable(root).size());
+        return true;
+    }
+};
+
+struct test_gc_5_t : public test_t {
+
+    test_gc_5_t()
+        : test_t("test gc 5")
+    {
+    }
+
+    bool run()
+    {
+        using namespace tengu;
+
+        int ref = 0;
+        gc_t gc;
+
+        // build a chain and promote it
+        object_t *root = gc.alloc<object_t>(ref);
+        object_t *tail = root;
+        for (int i = 0; i < 100; ++i) {
+            gc.write(tail, tail->a, gc.alloc<object_t>(ref));
+            tail = tail->a;
+        }
+        TEST_ASSERT(gc.young() == 101);
+        gc.check_in(root);
+        TEST_ASSERT(gc.collect_minor());
+        TEST_ASSERT(gc.young() == 0);
+        TEST_ASSERT(ref == 101);
+        TEST_ASSERT(gc_header_t::from(tail)->old());
+
+        // young garbage, plus a young pair only reachable from an old object
+        for (int i = 0; i < 1000; ++i) {
+            gc.alloc<object_t>(ref);
+        }
+        object_t *young = gc.alloc<object_t>(ref);
+        gc.write(young, young->a, gc.alloc<object_t>(ref));
+        gc.write(tail, tail->b, young);
+
+        // large objects start old and are remembered
+        object_t *big = gc.alloc<big_object_t>(ref);
+        big->a = gc.alloc<object_t>(ref);
+        TEST_ASSERT(gc_header_t::from(big)->old());
+
+        // no roots are checked in, old objects are assumed live
+        TEST_ASSERT(gc.collect_minor());
+        TEST_ASSERT(ref == 101 + 2 + 2);
+        TEST_ASSERT(gc_header_t::from(young->a)->old());
+        TEST_ASSERT(size_t(ref) == gc.allocs().size());
+
+        // a full collection reclaims old garbage too
+        gc.write(root, root->a, (object_t*)nullptr);
+        gc.check_in(root);
+        gc.collect();
+        TEST_ASSERT(ref == 1);
+
+        // full collections also empty the young list, promoting survivors
+        for (int i = 0; i < 1000; ++i) {
+            gc.alloc<object_t>(ref);
+        }
+        object_t *kept = gc.alloc<object_t>(ref);
+        gc.write(root, root->a, kept);
+        gc.check_in(root);
+        gc.collect();
+        TEST_ASSERT(gc.young() == 0);
+        TEST_ASSERT(ref == 2 && gc_header_t::from(kept)->old());
+        gc.check_in(root);
+        while (!gc.step(1000)) {
+        }
+        TEST_ASSERT(gc.young() == 0 && ref == 2);
+
+        // large objects are freed straight out of the remembered set,
+        // leaving the ones still reachable in it
+        object_t *big_kept = nullptr;
+        for (int i = 0; i < 500; ++i) {
+            object_t *obj = gc.alloc<big_object_t>(ref);
+            if (i == 250) {
+                big_kept = obj;
+            }
+        }
+        gc.write(root, root->b, big_kept);
+        gc.check_in(root);
+        gc.collect();
+        TEST_ASSERT(ref == 3 && size_t(ref) == gc.allocs().size());
+        return true;
+    }
+};
+
+struct test_gc_6_t : public test_t {
+
+    test_gc_6_t()
+        : test_t("test gc 6")
+    {
+    }
+
+    // build the same random graph into a serial and a parallel gc and
+    // check they both keep exactly the same number of objects
+    bool run()
+    {
+        using namespace tengu;
+
+        int ref[2] = {0, 0};
+        gc_t gc[2];
+        gc[1].set_threads(4);
+        object_t *root[2];
+
+        for (int g = 0; g < 2; ++g) {
+            srand(1234);
+            std::vector<object_t*> nodes;
+            for (int i = 0; i < 20000; ++i) {
+                nodes.push_back(gc[g].alloc<object_t>(ref[g]));
+            }
+            for (object_t *n : nodes) {
+                n->a = nodes[rand() % nodes.size()];
+                n->b = (rand() % 3) ? nodes[rand() % nodes.size()] : nullptr;
+            }
+            root[g] = nodes[0];
+        }
+        for (int i = 0; i < 4; ++i) {
+            for (int g = 0; g < 2; ++g) {
+                gc[g].check_in(root[g]);
+                gc[g].collect();
+            }
+            TEST_ASSERT(ref[0] == ref[1]);
+            TEST_ASSERT(size_t(ref[1]) == gc[1].allocs().size());
+            // cut the graph down a little each time
+            for (int g = 0; g < 2; ++g) {
+                srand(i);
+                const auto &a = gc[g].allocs();
+                for (int j = 0; j < 100; ++j) {
+                    object_t *o = static_cast<object_t*>(a[rand() % a.size()]);
+                    o->a = nullptr;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 6> reg_test = {
     test_lib::register_t::test<test_gc_1_t>(),
-    test_lib::register_t::test<test_gc_2_t>()
+    test_lib::register_t::test<test_gc_2_t>(),
+    test_lib::register_t::test<test_gc_3_t>(),
+    test_lib::register_t::test<test_gc_4_t>(),
+    test_lib::register_t::test<test_gc_5_t>(),
+    test_lib::register_t::test<test_gc_6_t>()
 };
@@ -0,0 +1,177 @@
+#include <array>
+#include <atomic>
+#include <vector>
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/jobs.h"
+
+using namespace test_lib;
+
+// jobs run with a counter are all done once wait returns
+struct test_jobs_1_t: public test_t {
+
+    test_jobs_1_t()
+        : test_t("test_jobs_1_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        for (uint32_t workers = 0; workers < 4; ++workers) {
+            job_pool_t pool(workers);
+            std::atomic<uint32_t> sum(0);
+            job_counter_t counter;
+            for (uint32_t i = 1; i <= 1000; ++i) {
+                pool.run([&sum, i]() { sum.fetch_add(i); }, &counter);
+            }
+            pool.wait(counter);
+            TEST_ASSERT(counter.done());
+            TEST_ASSERT(sum.load() == 500500);
+        }
+        return true;
+    }
+};
+
+// jobs given an 'after' counter only start once it reaches zero
+struct test_jobs_2_t: public test_t {
+
+    test_jobs_2_t()
+        : test_t("test_jobs_2_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        job_pool_t pool(3);
+        for (int pass = 0; pass < 50; ++pass) {
+            std::atomic<uint32_t> first(0);
+            std::atomic<uint32_t> bad(0);
+            job_counter_t stage_a, stage_b;
+            for (int i = 0; i < 64; ++i) {
+                pool.run([&first]() { first.fetch_add(1); }, &stage_a);
+            }
+            for (int i = 0; i < 64; ++i) {
+                pool.run([&first, &bad]() {
+                    if (first.load() != 64) {
+                        bad.fetch_add(1);
+                    }
+                }, &stage_b, &stage_a);
+            }
+            pool.wait(stage_b);
+            TEST_ASSERT(stage_a.done());
+            TEST_ASSERT(bad.load() == 0);
+        }
+        // a dependency which is already satisfied runs straight away
+        job_counter_t none, done;
+        bool ran = false;
+        pool.run([&ran]() { ran = true; }, &done, &none);
+        pool.wait(done);
+        TEST_ASSERT(ran);
+        return true;
+    }
+};
+
+// parallel_for visits every index exactly once, including when nested
+struct test_jobs_3_t: public test_t {
+
+    test_jobs_3_t()
+        : test_t("test_jobs_3_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        job_pool_t pool(3);
+        const size_t count = 10007;
+        for (size_t grain : {1, 7, 64, 20000}) {
+            std::vector<std::atomic<uint32_t>> hits(count);
+            for (auto& h : hits) {
+                h.store(0);
+            }
+            pool.parallel_for(count, grain, [&](size_t begin, size_t end) {
+                if (end - begin > grain) {
+                    hits[begin].fetch_add(100);
+                }
+                for (size_t i = begin; i < end; ++i) {
+                    hits[i].fetch_add(1);
+                }
+            });
+            for (auto& h : hits) {
+                TEST_ASSERT(h.load() == 1);
+            }
+        }
+        // nested loops run from inside a job
+        std::atomic<uint32_t> total(0);
+        pool.parallel_for(16, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                pool.parallel_for(100, 10, [&](size_t b, size_t e) {
+                    total.fetch_add(uint32_t(e - b));
+                });
+            }
+        });
+        TEST_ASSERT(total.load() == 1600);
+        // empty ranges do nothing
+        pool.parallel_for(0, 1, [&](size_t, size_t) { total.store(0); });
+        TEST_ASSERT(total.load() == 1600);
+        return true;
+    }
+};
+
+// the deque hands each job out exactly once under contention
+struct test_jobs_4_t: public test_t {
+
+    test_jobs_4_t()
+        : test_t("test_jobs_4_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        const size_t count = 100000;
+        std::vector<uint8_t> seen(count, 0);
+        job_deque_t deque;
+        std::atomic<bool> stop(false);
+        std::atomic<size_t> stolen(0);
+        std::vector<std::thread> thief;
+        for (int i = 0; i < 3; ++i) {
+            thief.emplace_back([&]() {
+                while (!stop.load() || !deque.empty()) {
+                    job_t* job = deque.steal();
+                    if (job) {
+                        seen[size_t(job) - 1] += 1;
+                        stolen.fetch_add(1);
+                    }
+                }
+            });
+        }
+        size_t popped = 0;
+        for (size_t i = 0; i < count; ++i) {
+            job_t* job = reinterpret_cast<job_t*>(i + 1);
+            while (!deque.push(job)) {
+                yield();
+            }
+            if ((i & 3) == 0) {
+                job = deque.pop();
+                if (job) {
+                    seen[size_t(job) - 1] += 1;
+                    ++popped;
+                }
+            }
+        }
+        stop.store(true);
+        for (std::thread& t : thief) {
+            t.join();
+        }
+        TEST_ASSERT(popped + stolen.load() == count);
+        for (uint8_t s : seen) {
+            TEST_ASSERT(s == 1);
+        }
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 4> reg_test = {
+    test_lib::register_t::test<test_jobs_1_t>(),
+    test_lib::register_t::test<test_jobs_2_t>(),
+    test_lib::register_t::test<test_jobs_3_t>(),
+    test_lib::register_t::test<test_jobs_4_t>()
+};
@@ -1,6 +1,9 @@
+#include <array>
 #include "../test_lib/test_lib.h"
 #include "../../framework_core/objects.h"
 #include "../../framework_core/random.h"
+#include "../../framework_core/jobs.h"
+#include <atomic>
 
 using namespace tengu;
 using namespace test_lib;
@@ -152,6 +155,12 @@ struct test_object_2_t: public test_t {
 
         TEST_ASSERT(make->counter_ == 0);
 
+        // out of range types are turned away rather than growing the table
+        TEST_ASSERT(!factory.add_creator(object_factory_t::c_max_types,
+            new test_obj_3_t::make_t));
+        TEST_ASSERT(!factory.add_creator(0xfffffff0u, new test_obj_3_t::make_t));
+        TEST_ASSERT(!factory.create(0xfffffff0u).valid());
+
         return true;
     }
 };
@@ -237,6 +246,7 @@ struct test_object_5_t: public test_t {
             }
 
             void init(int value) {
+                value_ = value;
             }
         };
 
@@ -353,3 +363,713 @@ struct test_object_7_t: public test_t {
         return true;
     }
 };
+
+struct test_object_8_t: public test_t {
+
+    enum {
+        e_obj_pooled_t
+    };
+
+    struct obj_t : object_ex_t<e_obj_pooled_t, obj_t, object_pool_t<obj_t, 16> > {
+        uint32_t id_;
+
+        obj_t(object_service_t)
+                : object_ex_t(), id_(0) {
+        }
+
+        void init(uint32_t id) {
+            id_ = id;
+        }
+
+        void kill() {
+            destroy();
+        }
+    };
+
+    test_object_8_t()
+            : test_t("test_object_8_t") {}
+
+    virtual bool run() override {
+        using namespace tengu;
+
+        object_factory_t factory(nullptr);
+        factory.add_creator<obj_t>();
+
+        size_t used = 0, capacity = 0;
+        TEST_ASSERT(factory.occupancy(obj_t::type(), used, capacity));
+        TEST_ASSERT(used == 0 && capacity == 0);
+
+        std::vector<object_t*> objs;
+        for (uint32_t i = 0; i < 40; ++i) {
+            object_ref_t ref = factory.create<obj_t>(i);
+            TEST_ASSERT(ref.valid());
+            objs.push_back(&ref.get());
+        }
+        factory.tick();
+
+        TEST_ASSERT(factory.occupancy(obj_t::type(), used, capacity));
+        TEST_ASSERT(used == 40 && capacity == 48);
+
+        // objects within a slab should be laid out contiguously
+        for (size_t i = 1; i < 16; ++i) {
+            const uint8_t* a = reinterpret_cast<const uint8_t*>(objs[0]);
+            const uint8_t* b = reinterpret_cast<const uint8_t*>(objs[i]);
+            TEST_ASSERT(size_t(b - a) == i * sizeof(obj_t));
+        }
+
+        // kill half of them and make sure the slots are recycled
+        for (size_t i = 0; i < objs.size(); i += 2) {
+            objs[i]->cast<obj_t>().kill();
+        }
+        factory.collect();
+        TEST_ASSERT(factory.occupancy(obj_t::type(), used, capacity));
+        TEST_ASSERT(used == 20 && capacity == 48);
+
+        for (uint32_t i = 0; i < 20; ++i) {
+            factory.create<obj_t>(i);
+        }
+        factory.tick();
+        TEST_ASSERT(factory.occupancy(obj_t::type(), used, capacity));
+        TEST_ASSERT(used == 40 && capacity == 48);
+
+        // unpooled creators do not report occupancy
+        factory.add_creator<test_obj_1_t>();
+        TEST_ASSERT(!factory.occupancy(test_obj_1_t::type(), used, capacity));
+
+        return true;
+    }
+};
+
+struct test_object_9_t: public test_t {
+
+    enum {
+        e_obj_band_t,
+        e_obj_child_t,
+    };
+
+    static const int32_t c_bands = 4;
+    static const int32_t c_per_band = 500;
+
+    struct state_t {
+        object_factory_t* factory_;
+        std::atomic<int32_t> ticked_[c_bands];
+        std::atomic<int32_t> errors_;
+    };
+
+    struct child_t : object_ex_t<e_obj_child_t, child_t> {
+        child_t(object_service_t)
+                : object_ex_t() {
+            order_ = c_bands;
+        }
+    };
+
+    struct obj_t : object_ex_t<e_obj_band_t, obj_t> {
+        state_t* state_;
+
+        obj_t(object_service_t service)
+                : object_ex_t(), state_(static_cast<state_t*>(service)) {
+        }
+
+        void init(int32_t band, bool thread_safe) {
+            order_ = band;
+            thread_safe_ = thread_safe;
+        }
+
+        virtual void tick() override {
+            // every object in the previous band must have ticked already
+            if (order_ > 0 && state_->ticked_[order_ - 1] != c_per_band) {
+                ++state_->errors_;
+            }
+            // spawn a child which goes through the staging list
+            state_->factory_->create<child_t>();
+            ++state_->ticked_[order_];
+        }
+    };
+
+    test_object_9_t()
+            : test_t("test_object_9_t") {}
+
+    virtual bool run() override {
+        using namespace tengu;
+
+        state_t state;
+        state.errors_ = 0;
+
+        job_pool_t jobs(4);
+        object_factory_t factory(&state);
+        state.factory_ = &factory;
+        factory.add_creator<obj_t>();
+        factory.add_creator<child_t>();
+        factory.set_jobs(&jobs, 16);
+
+        for (int32_t i = 0; i < c_bands * c_per_band; ++i) {
+            // every seventh object opts out of parallel ticking
+            factory.create<obj_t>((i * 7) % c_bands, (i % 7) != 0);
+        }
+        factory.tick();
+        factory.sort();
+
+        for (int32_t frame = 0; frame < 4; ++frame) {
+            for (auto& t : state.ticked_) {
+                t = 0;
+            }
+            factory.tick();
+            for (auto& t : state.ticked_) {
+                TEST_ASSERT(t == c_per_band);
+            }
+            TEST_ASSERT(state.errors_ == 0);
+            factory.sort();
+            factory.collect();
+        }
+        return true;
+    }
+};
+
+struct test_object_10_t: public test_t {
+
+    struct obj_t : object_ex_t<0, obj_t> {
+        std::vector<obj_t*>* log_;
+        uint32_t id_;
+
+        obj_t(object_service_t service)
+                : object_ex_t()
+                , log_(static_cast<std::vector<obj_t*>*>(service))
+                , id_(0) {
+        }
+
+        void init(uint32_t id, int32_t order) {
+            id_ = id;
+            order_ = order;
+        }
+
+        void set_order(int32_t order) {
+            order_ = order;
+        }
+
+        virtual void tick() override {
+            log_->push_back(this);
+        }
+    };
+
+    test_object_10_t()
+            : test_t("test_object_10_t") {}
+
+    // objects must tick by ascending order, oldest first within an order
+    static bool check(const std::vector<obj_t*>& log, bool stable = true) {
+        for (size_t i = 1; i < log.size(); ++i) {
+            const obj_t* a = log[i - 1];
+            const obj_t* b = log[i];
+            if (a->order() > b->order()) {
+                return false;
+            }
+            if (stable && a->order() == b->order() && a->id_ > b->id_) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+
+        random_t random(0x5678);
+        std::vector<obj_t*> log;
+        object_factory_t factory(&log);
+        factory.add_creator<obj_t>();
+
+        uint32_t id = 0;
+        for (int32_t batch = 0; batch < 20; ++batch) {
+            // mix of small and large, positive and negative orders
+            for (int32_t i = 0; i < 50; ++i) {
+                int32_t order = random.rand_range<int32_t>(-8, 8);
+                if (random.rand_chance(10)) {
+                    order *= 0x10000;
+                }
+                factory.create<obj_t>(id++, order);
+            }
+            log.clear();
+            factory.tick();
+            TEST_ASSERT(check(log));
+        }
+
+        // reorder some objects and have sort() restore the order
+        log.clear();
+        factory.tick();
+        for (size_t i = 0; i < log.size(); i += 3) {
+            log[i]->set_order(random.rand_range<int32_t>(-100, 100));
+        }
+        factory.sort();
+        log.clear();
+        factory.tick();
+        TEST_ASSERT(log.size() == id);
+        TEST_ASSERT(check(log, false));
+
+        return true;
+    }
+};
+
+struct test_object_11_t: public test_t {
+
+    enum {
+        e_obj_a_t,
+        e_obj_b_t,
+    };
+
+    struct obj_a_t : object_ex_t<e_obj_a_t, obj_a_t, object_pool_t<obj_a_t, 4> > {
+        obj_a_t(object_service_t)
+                : object_ex_t() {
+        }
+
+        void kill() {
+            destroy();
+        }
+    };
+
+    struct obj_b_t : object_ex_t<e_obj_b_t, obj_b_t> {
+        obj_b_t(object_service_t)
+                : object_ex_t() {
+        }
+    };
+
+    test_object_11_t()
+            : test_t("test_object_11_t") {}
+
+    virtual bool run() override {
+        using namespace tengu;
+
+        TEST_ASSERT(sizeof(object_handle_t) == sizeof(uint32_t));
+        TEST_ASSERT(!object_handle_t().valid());
+
+        object_factory_t factory(nullptr);
+        factory.add_creator<obj_a_t>();
+        factory.add_creator<obj_b_t>();
+
+        // a default handle never resolves
+        TEST_ASSERT(factory.resolve(object_handle_t()) == nullptr);
+
+        object_handle_t h1 = factory.create<obj_a_t>()->handle();
+        object_handle_t h2 = factory.create<obj_b_t>()->handle();
+        TEST_ASSERT(h1.valid() && h2.valid() && h1 != h2);
+        factory.tick();
+
+        obj_a_t* a = factory.resolve<obj_a_t>(h1);
+        TEST_ASSERT(a && a->handle() == h1);
+        TEST_ASSERT(factory.resolve<obj_b_t>(h1) == nullptr);
+        TEST_ASSERT(factory.resolve<obj_b_t>(h2) != nullptr);
+
+        // destroyed objects stop resolving immediately
+        a->kill();
+        TEST_ASSERT(factory.resolve(h1) == nullptr);
+        factory.collect();
+        TEST_ASSERT(factory.resolve(h1) == nullptr);
+
+        // the pooled storage is recycled but the handle slot waits in the
+        // free queue, so the old handle stays stale
+        object_t* c = &factory.create<obj_a_t>().get();
+        TEST_ASSERT(c == a);
+        object_handle_t h3 = c->handle();
+        TEST_ASSERT(h3.index() != h1.index());
+        TEST_ASSERT(factory.resolve(h1) == nullptr);
+        TEST_ASSERT(factory.resolve(h3) == c);
+
+        // churn enough objects for the slot to come round again, it does
+        // so under a new generation
+        bool reused = false;
+        for (uint32_t i = 0; i < object_factory_t::c_min_free * 3; ++i) {
+            object_ref_t ref = factory.create<obj_a_t>();
+            reused |= ref->handle().index() == h1.index();
+            TEST_ASSERT(ref->handle() != h1);
+            factory.tick();
+            ref->cast<obj_a_t>().kill();
+            ref.dispose();
+            factory.collect();
+            TEST_ASSERT(factory.resolve(h1) == nullptr);
+        }
+        TEST_ASSERT(reused);
+
+        // handles survive compaction of the object list
+        std::vector<object_handle_t> handles;
+        for (int i = 0; i < 100; ++i) {
+            handles.push_back(factory.create<obj_a_t>()->handle());
+        }
+        factory.tick();
+        for (size_t i = 0; i < handles.size(); i += 2) {
+            factory.resolve<obj_a_t>(handles[i])->kill();
+        }
+        factory.collect();
+        for (size_t i = 0; i < handles.size(); ++i) {
+            object_t* obj = factory.resolve(handles[i]);
+            TEST_ASSERT((i & 1) ? (obj && obj->handle() == handles[i]) : !obj);
+        }
+        TEST_ASSERT(factory.resolve(h2) != nullptr);
+        return true;
+    }
+};
+
+struct test_object_12_t: public test_t {
+
+    enum {
+        e_obj_a_t,
+        e_obj_b_t,
+    };
+
+    struct entry_t {
+        int32_t order_;
+        object_type_t type_;
+    };
+
+    template <object_type_t id_t>
+    struct obj_t : object_ex_t<id_t, obj_t<id_t> > {
+        std::vector<entry_t>* log_;
+
+        obj_t(object_service_t service)
+                : log_(static_cast<std::vector<entry_t>*>(service)) {
+        }
+
+        void init(int32_t order) {
+            this->order_ = order;
+        }
+
+        virtual void tick() override {
+            log_->push_back(entry_t{this->order(), this->type_});
+        }
+    };
+
+    typedef obj_t<e_obj_a_t> obj_a_t;
+    typedef obj_t<e_obj_b_t> obj_b_t;
+
+    // creator which counts how many batches it has been asked to tick
+    struct counting_create_t : object_create_t<obj_b_t> {
+        counting_create_t(int32_t& batches)
+                : batches_(batches) {
+        }
+
+        virtual void tick_batch(object_t* const* obj, size_t count) override {
+            ++batches_;
+            object_create_t<obj_b_t>::tick_batch(obj, count);
+        }
+
+        int32_t& batches_;
+    };
+
+    test_object_12_t()
+            : test_t("test_object_12_t") {}
+
+    virtual bool run() override {
+        using namespace tengu;
+
+        int32_t batches = 0;
+        std::vector<entry_t> log;
+        object_factory_t factory(&log);
+        factory.add_creator<obj_a_t>();
+        factory.add_creator(obj_b_t::type(), new counting_create_t(batches));
+        factory.set_grouped(true);
+
+        // interleave types within three order bands
+        for (int32_t i = 0; i < 90; ++i) {
+            const int32_t order = i % 3;
+            if (i & 1) {
+                factory.create<obj_a_t>(order);
+            } else {
+                factory.create<obj_b_t>(order);
+            }
+        }
+        factory.tick();
+        TEST_ASSERT(log.empty());
+        TEST_ASSERT(batches == 0);
+
+        factory.tick();
+        TEST_ASSERT(log.size() == 90);
+        // one batch of obj_b_t per band
+        TEST_ASSERT(batches == 3);
+        // bands stay in order and each type is contiguous within a band
+        int32_t changes = 0;
+        for (size_t i = 1; i < log.size(); ++i) {
+            TEST_ASSERT(log[i - 1].order_ <= log[i].order_);
+            if (log[i - 1].order_ == log[i].order_ &&
+                log[i - 1].type_ != log[i].type_) {
+                ++changes;
+            }
+        }
+        TEST_ASSERT(changes == 3);
+
+        // ungrouped ticking visits the same objects
+        factory.set_grouped(false);
+        log.clear();
+        factory.tick();
+        TEST_ASSERT(log.size() == 90);
+        TEST_ASSERT(batches == 3);
+        return true;
+    }
+};
+
+struct test_object_13_t: public test_t {
+
+    enum {
+        e_obj_a_t = 3,
+        e_obj_b_t = 40,
+    };
+
+    template <object_type_t id_t>
+    struct obj_t : object_ex_t<id_t, obj_t<id_t> > {
+        obj_t(object_service_t) {
+        }
+
+        void kill() {
+            this->destroy();
+        }
+    };
+
+    test_object_13_t()
+            : test_t("test_object_13_t") {}
+
+    virtual bool run() override {
+        using namespace tengu;
+
+        typedef obj_t<e_obj_a_t> obj_a_t;
+        typedef obj_t<e_obj_b_t> obj_b_t;
+
+        object_factory_t factory(nullptr);
+        factory.add_creator<obj_a_t>();
+        factory.add_creator<obj_b_t>();
+
+        object_stats_t stats;
+        TEST_ASSERT(!factory.stats(0, stats));
+        TEST_ASSERT(!factory.stats(1000, stats));
+        TEST_ASSERT(!factory.create(e_obj_b_t + 1).valid());
+
+        std::vector<object_handle_t> a;
+        for (int i = 0; i < 10; ++i) {
+            a.push_back(factory.create<obj_a_t>()->handle());
+        }
+        factory.create<obj_b_t>();
+        factory.tick();
+
+        TEST_ASSERT(factory.stats(e_obj_a_t, stats));
+        TEST_ASSERT(stats.created_ == 10 && stats.destroyed_ == 0);
+        TEST_ASSERT(stats.live() == 10);
+        TEST_ASSERT(factory.stats(e_obj_b_t, stats));
+        TEST_ASSERT(stats.created_ == 1 && stats.live() == 1);
+
+        for (int i = 0; i < 4; ++i) {
+            factory.resolve<obj_a_t>(a[i])->kill();
+        }
+        factory.collect();
+        TEST_ASSERT(factory.stats(e_obj_a_t, stats));
+        TEST_ASSERT(stats.created_ == 10 && stats.destroyed_ == 4);
+        TEST_ASSERT(stats.live() == 6);
+        return true;
+    }
+};
+
+struct test_object_14_t: public test_t {
+
+    enum {
+        e_obj_state_t,
+    };
+
+    struct obj_t : object_ex_t<e_obj_state_t, obj_t, object_pool_t<obj_t, 8> > {
+        int32_t x_, dx_;
+
+        obj_t(object_service_t)
+                : object_ex_t(), x_(0), dx_(0) {
+        }
+
+        void init(int32_t x, int32_t dx) {
+            x_ = x;
+            dx_ = dx;
+        }
+
+        void kill() {
+            destroy();
+        }
+
+        virtual void tick() override {
+            x_ += dx_;
+        }
+
+        virtual void save(snapshot_t& out) const override {
+            out.write(x_);
+            out.write(dx_);
+        }
+
+        virtual void load(snapshot_reader_t& in) override {
+            in.read(x_);
+            in.read(dx_);
+        }
+    };
+
+    test_object_14_t()
+            : test_t("test_object_14_t") {}
+
+    virtual bool run() override {
+        using namespace tengu;
+
+        object_factory_t factory(nullptr);
+        factory.add_creator<obj_t>();
+
+        std::vector<object_handle_t> handles;
+        for (int32_t i = 0; i < 20; ++i) {
+            handles.push_back(factory.create<obj_t>(i * 10, i)->handle());
+        }
+        factory.tick();
+        // one object is still staged when the snapshot is taken
+        const object_handle_t staged = factory.create<obj_t>(-1, -1)->handle();
+
+        snapshot_t snap(256);
+        factory.snapshot(snap);
+        TEST_ASSERT(snap.size() > 0);
+
+        // move the world on: tick, kill, collect and spawn
+        std::vector<object_handle_t> spawned;
+        for (int32_t frame = 0; frame < 3; ++frame) {
+            factory.tick();
+            factory.resolve<obj_t>(handles[frame * 2])->kill();
+            factory.collect();
+            spawned.push_back(factory.create<obj_t>(1000, 0)->handle());
+        }
+        TEST_ASSERT(factory.resolve(handles[0]) == nullptr);
+        TEST_ASSERT(factory.resolve<obj_t>(handles[1])->x_ != 10);
+
+        // roll back
+        TEST_ASSERT(factory.restore(snap));
+        for (int32_t i = 0; i < 20; ++i) {
+            const obj_t* obj = factory.resolve<obj_t>(handles[i]);
+            TEST_ASSERT(obj);
+            TEST_ASSERT(obj->x_ == i * 10 && obj->dx_ == i);
+        }
+        TEST_ASSERT(factory.resolve<obj_t>(staged) != nullptr);
+        for (const object_handle_t& h : spawned) {
+            TEST_ASSERT(factory.resolve(h) == nullptr);
+        }
+        // orphans waiting to be collected are left out of new snapshots
+        snapshot_t again;
+        factory.snapshot(again);
+        TEST_ASSERT(again.size() == snap.size());
+
+        // the world ticks on from the restored state
+        factory.tick();
+        factory.collect();
+        TEST_ASSERT(factory.resolve<obj_t>(handles[3])->x_ == 33);
+
+        object_stats_t stats;
+        TEST_ASSERT(factory.stats(obj_t::type(), stats));
+        TEST_ASSERT(stats.live() == 21);
+        size_t used = 0, capacity = 0;
+        TEST_ASSERT(factory.occupancy(obj_t::type(), used, capacity));
+        TEST_ASSERT(used == 21);
+
+        // a truncated snapshot, or one with types this factory can not
+        // make, is refused and the world is left alone
+        snapshot_t cut;
+        cut.write(snap.data(), snap.size() - 4);
+        TEST_ASSERT(!factory.restore(cut));
+        // as is one which leaves an occupied slot without an object
+        snapshot_t short_count;
+        short_count.write(snap.data(), snap.size());
+        uint32_t slots = 0, count = 0;
+        memcpy(&slots, snap.data() + 4, sizeof(slots));
+        const size_t count_pos = 5 * sizeof(uint32_t) + slots * 3 * sizeof(uint32_t);
+        memcpy(&count, snap.data() + count_pos, sizeof(count));
+        --count;
+        memcpy(short_count.data() + count_pos, &count, sizeof(count));
+        TEST_ASSERT(!factory.restore(short_count));
+        object_factory_t other(nullptr);
+        TEST_ASSERT(!other.restore(snap));
+        TEST_ASSERT(factory.resolve<obj_t>(handles[3])->x_ == 33);
+        TEST_ASSERT(factory.resolve<obj_t>(staged) != nullptr);
+        TEST_ASSERT(factory.stats(obj_t::type(), stats) && stats.live() == 21);
+
+        // replaying the same actions hands out the same handles
+        TEST_ASSERT(factory.restore(snap));
+        factory.collect();
+        std::vector<object_handle_t> replay;
+        for (int32_t frame = 0; frame < 3; ++frame) {
+            factory.tick();
+            factory.resolve<obj_t>(handles[frame * 2])->kill();
+            factory.collect();
+            replay.push_back(factory.create<obj_t>(1000, 0)->handle());
+        }
+        TEST_ASSERT(replay == spawned);
+        return true;
+    }
+};
+
+// running out of handles fails the create rather than aliasing a slot
+struct test_object_15_t: public test_t {
+
+    enum {
+        e_obj_t,
+    };
+
+    struct obj_t : object_ex_t<e_obj_t, obj_t> {
+        obj_t(object_service_t)
+                : object_ex_t()
+                , value_(0) {
+        }
+
+        void init(int value) {
+            value_ = value;
+        }
+
+        void kill() {
+            destroy();
+        }
+
+        int value_;
+    };
+
+    test_object_15_t()
+            : test_t("test_object_15_t") {}
+
+    virtual bool run() override {
+        using namespace tengu;
+
+        object_factory_t factory(nullptr);
+        factory.add_creator<obj_t>();
+
+        const uint32_t slots = object_handle_t::c_index_mask + 1;
+        object_handle_t first, last;
+        for (uint32_t i = 0; i < slots; ++i) {
+            last = factory.create<obj_t>()->handle();
+            first = i ? first : last;
+        }
+        TEST_ASSERT(last.valid() && last.index() == object_handle_t::c_index_mask);
+
+        // the table is full and nothing has been freed
+        TEST_ASSERT(!factory.create<obj_t>().valid());
+        TEST_ASSERT(!factory.create<obj_t>(7).valid());
+        TEST_ASSERT(factory.resolve(first) && factory.resolve(last));
+        object_stats_t stats;
+        TEST_ASSERT(factory.stats(obj_t::type(), stats) && stats.created_ == slots);
+
+        // a freed slot is reused straight away once the table is full
+        factory.tick();
+        factory.resolve<obj_t>(first)->kill();
+        factory.collect();
+        object_ref_t again = factory.create<obj_t>(7);
+        TEST_ASSERT(again.valid() && again->cast<obj_t>().value_ == 7);
+        TEST_ASSERT(again->handle().index() == first.index());
+        TEST_ASSERT(factory.resolve(first) == nullptr);
+        TEST_ASSERT(factory.resolve(last) != nullptr);
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 15> reg_test = {
+    test_lib::register_t::test<test_object_1_t>(),
+    test_lib::register_t::test<test_object_2_t>(),
+    test_lib::register_t::test<test_object_3_t>(),
+    test_lib::register_t::test<test_object_4_t>(),
+    test_lib::register_t::test<test_object_5_t>(),
+    test_lib::register_t::test<test_object_6_t>(),
+    test_lib::register_t::test<test_object_7_t>(),
+    test_lib::register_t::test<test_object_8_t>(),
+    test_lib::register_t::test<test_object_9_t>(),
+    test_lib::register_t::test<test_object_10_t>(),
+    test_lib::register_t::test<test_object_11_t>(),
+    test_lib::register_t::test<test_object_12_t>(),
+    test_lib::register_t::test<test_object_13_t>(),
+    test_lib::register_t::test<test_object_14_t>(),
+    test_lib::register_t::test<test_object_15_t>()
+};
@@ -0,0 +1,108 @@
+#include <array>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/profile.h"
+
+using namespace test_lib;
+
+namespace {
+const tengu::profile_stat_t* find_stat(
+    const std::vector<tengu::profile_stat_t>& stats,
+    const char* name)
+{
+    for (const auto& s : stats) {
+        if (strcmp(s.name_, name) == 0) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+} // namespace {}
+
+// zones and counters are gathered into per frame totals
+struct test_profile_1_t: public test_t {
+
+    test_profile_1_t()
+        : test_t("test_profile_1_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        profiler_t& prof = profiler_t::inst();
+        prof.clear();
+        {
+            profile_zone_t outer("test.outer");
+            for (int i = 0; i < 3; ++i) {
+                profile_zone_t inner("test.inner");
+            }
+            profile_counter("test.count", 42);
+        }
+        prof.frame();
+        std::vector<profile_stat_t> stats;
+        prof.stats(stats);
+        const profile_stat_t* outer = find_stat(stats, "test.outer");
+        const profile_stat_t* inner = find_stat(stats, "test.inner");
+        const profile_stat_t* count = find_stat(stats, "test.count");
+        TEST_ASSERT(outer && inner && count);
+        TEST_ASSERT(outer->count_ == 1 && outer->depth_ == 0);
+        TEST_ASSERT(inner->count_ == 3 && inner->depth_ == 1);
+        TEST_ASSERT(outer->value_ >= inner->value_);
+        TEST_ASSERT(count->type_ == e_profile_counter && count->value_ == 42.0);
+        // the next frame only sees what happened since
+        prof.frame();
+        prof.stats(stats);
+        TEST_ASSERT(stats.empty());
+        return true;
+    }
+};
+
+// trace export covers every thread and survives the ring wrapping
+struct test_profile_2_t: public test_t {
+
+    test_profile_2_t()
+        : test_t("test_profile_2_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        profiler_t& prof = profiler_t::inst();
+        prof.clear();
+        std::thread worker([]() {
+            profile_thread("test_worker");
+            for (uint64_t i = 0; i < profile_thread_t::c_capacity + 100; ++i) {
+                profile_zone_t zone("test.worker");
+            }
+        });
+        worker.join();
+        {
+            profile_zone_t zone("test.main");
+        }
+        std::string json;
+        prof.export_trace(json);
+        TEST_ASSERT(json.find("{\"traceEvents\":[") == 0);
+        TEST_ASSERT(json.find("\"name\":\"test_worker\"") != std::string::npos);
+        TEST_ASSERT(json.find("\"name\":\"test.main\",\"ph\":\"X\"") != std::string::npos);
+        // only the newest events of the worker are kept, less the slot the
+        // writer would fill next
+        size_t count = 0;
+        for (size_t at = json.find("test.worker"); at != std::string::npos;
+             at = json.find("test.worker", at + 1)) {
+            ++count;
+        }
+        TEST_ASSERT(count == profile_thread_t::c_capacity - 1);
+        prof.clear();
+        prof.export_trace(json);
+        TEST_ASSERT(json.find("test.") == std::string::npos);
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 2> reg_test = {
+    test_lib::register_t::test<test_profile_1_t>(),
+    test_lib::register_t::test<test_profile_2_t>()
+};
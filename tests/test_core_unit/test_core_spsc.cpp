@@ -0,0 +1,124 @@
+#include <array>
+#include <atomic>
+#include <thread>
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/spsc.h"
+#include "../../framework_core/thread.h"
+
+using namespace test_lib;
+
+// fills and drains in order, refusing pushes when full
+struct test_spsc_1_t: public test_t {
+
+    test_spsc_1_t()
+        : test_t("test_spsc_1_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        spsc_ring_t<uint32_t, 8> ring;
+        uint32_t v = 0;
+        TEST_ASSERT(ring.empty());
+        TEST_ASSERT(!ring.pop(v));
+        // go round a few times so the indices wrap the slots
+        for (uint32_t lap = 0; lap < 3; ++lap) {
+            for (uint32_t i = 0; i < 8; ++i) {
+                TEST_ASSERT(ring.push(lap * 8 + i));
+            }
+            TEST_ASSERT(!ring.push(99));
+            TEST_ASSERT(ring.size() == 8);
+            for (uint32_t i = 0; i < 8; ++i) {
+                TEST_ASSERT(ring.pop(v));
+                TEST_ASSERT(v == lap * 8 + i);
+            }
+            TEST_ASSERT(!ring.pop(v));
+        }
+        return true;
+    }
+};
+
+// a producer and consumer thread see every item once and in order
+struct test_spsc_2_t: public test_t {
+
+    test_spsc_2_t()
+        : test_t("test_spsc_2_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        const uint64_t count = 200000;
+        spsc_ring_t<uint64_t, 64> ring;
+        std::thread producer([&]() {
+            for (uint64_t i = 0; i < count; ++i) {
+                while (!ring.push(i)) {
+                    yield();
+                }
+            }
+        });
+        uint64_t expect = 0;
+        bool ordered = true;
+        while (expect < count) {
+            uint64_t v = 0;
+            if (ring.pop(v)) {
+                ordered &= (v == expect);
+                ++expect;
+            } else {
+                yield();
+            }
+        }
+        producer.join();
+        TEST_ASSERT(ordered);
+        TEST_ASSERT(ring.empty());
+        return true;
+    }
+};
+
+// the consumer keeps making progress while the producer is stalled part
+// way through a burst, nothing it does waits on the other side
+struct test_spsc_3_t: public test_t {
+
+    test_spsc_3_t()
+        : test_t("test_spsc_3_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        spsc_ring_t<uint32_t, 16> ring;
+        std::atomic<bool> stall(true);
+        std::atomic<bool> pushed(false);
+        std::thread producer([&]() {
+            ring.push(1);
+            ring.push(2);
+            pushed.store(true);
+            // stall with the ring in use, as a game thread might when
+            // descheduled
+            while (stall.load()) {
+                yield();
+            }
+            ring.push(3);
+        });
+        while (!pushed.load()) {
+            yield();
+        }
+        uint32_t v = 0;
+        TEST_ASSERT(ring.pop(v) && v == 1);
+        TEST_ASSERT(ring.pop(v) && v == 2);
+        // polling an empty ring returns straight away
+        for (int i = 0; i < 1000; ++i) {
+            TEST_ASSERT(!ring.pop(v));
+        }
+        stall.store(false);
+        producer.join();
+        TEST_ASSERT(ring.pop(v) && v == 3);
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 3> reg_test = {
+    test_lib::register_t::test<test_spsc_1_t>(),
+    test_lib::register_t::test<test_spsc_2_t>(),
+    test_lib::register_t::test<test_spsc_3_t>()
+};
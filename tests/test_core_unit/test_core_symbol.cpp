@@ -0,0 +1,123 @@
+#include <array>
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/objects.h"
+#include "../../framework_core/symbol.h"
+
+using namespace tengu;
+using namespace test_lib;
+
+struct test_symbol_1_t: public test_t {
+
+    test_symbol_1_t()
+        : test_t("test_symbol_1_t")
+    {
+    }
+
+    virtual bool run() override {
+        symbol_table_t table;
+        TEST_ASSERT(table.size() == 0);
+        TEST_ASSERT(table.find("hello") == c_no_symbol);
+
+        const symbol_t a = table.intern("hello");
+        const symbol_t b = table.intern("world");
+        TEST_ASSERT(a != c_no_symbol && b != c_no_symbol && a != b);
+        TEST_ASSERT(table.intern("hello") == a);
+        TEST_ASSERT(table.intern(std::string("world")) == b);
+        TEST_ASSERT(table.find("hello") == a);
+        TEST_ASSERT(strcmp(table.name(a), "hello") == 0);
+        TEST_ASSERT(table.size() == 2);
+
+        // enough symbols to force several table and chunk resizes
+        const char* first = table.name(a);
+        std::vector<symbol_t> syms;
+        for (int i = 0; i < 5000; ++i) {
+            syms.push_back(table.intern("sym_" + std::to_string(i)));
+        }
+        for (int i = 0; i < 5000; ++i) {
+            const std::string name = "sym_" + std::to_string(i);
+            TEST_ASSERT(table.find(name) == syms[i]);
+            TEST_ASSERT(name == table.name(syms[i]));
+        }
+        // names are stable once interned
+        TEST_ASSERT(table.name(a) == first);
+        TEST_ASSERT(table.find("sym_5000") == c_no_symbol);
+        return true;
+    }
+};
+
+struct test_symbol_2_t: public test_t {
+
+    enum {
+        e_type_named
+    };
+
+    struct obj_t : public object_ex_t<e_type_named, obj_t> {
+        obj_t(object_service_t)
+            : object_ex_t()
+        {
+        }
+    };
+
+    test_symbol_2_t()
+        : test_t("test_symbol_2_t")
+    {
+    }
+
+    virtual bool run() override {
+        object_factory_t factory(nullptr);
+        factory.add_creator<obj_t>();
+
+        object_map_t map;
+        TEST_ASSERT(!map.contains("player"));
+
+        object_ref_t player = factory.create<obj_t>();
+        map.insert("player", player);
+        TEST_ASSERT(map.contains("player"));
+        TEST_ASSERT(map.contains(std::string("player")));
+        TEST_ASSERT(map["player"] == player);
+
+        const symbol_t sym = intern("player");
+        TEST_ASSERT(map.contains(sym));
+        TEST_ASSERT(map[sym] == player);
+
+        // insert over an existing key replaces the object
+        object_ref_t other = factory.create<obj_t>();
+        map.insert(sym, other);
+        TEST_ASSERT(map.size() == 1);
+        TEST_ASSERT(map[sym] == other);
+
+        // churn enough names to exercise growth and tombstones
+        std::vector<symbol_t> keys;
+        for (int i = 0; i < 1000; ++i) {
+            keys.push_back(intern("obj_" + std::to_string(i)));
+            map.insert(keys.back(), factory.create<obj_t>());
+        }
+        TEST_ASSERT(map.size() == 1001);
+        for (int i = 0; i < 1000; i += 2) {
+            map.remove(keys[i]);
+        }
+        TEST_ASSERT(map.size() == 501);
+        for (int i = 0; i < 1000; ++i) {
+            TEST_ASSERT(map.contains(keys[i]) == ((i & 1) == 1));
+        }
+        for (int i = 0; i < 1000; i += 2) {
+            map.insert(keys[i], player);
+        }
+        for (int i = 0; i < 1000; i += 2) {
+            TEST_ASSERT(map[keys[i]] == player);
+        }
+        TEST_ASSERT(map.size() == 1001);
+
+        // removal releases the maps reference
+        const uint32_t refs = other->ref_count();
+        map.remove("player");
+        TEST_ASSERT(!map.contains(sym));
+        TEST_ASSERT(other->ref_count() == refs - 1);
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 2> reg_test = {
+    test_lib::register_t::test<test_symbol_1_t>(),
+    test_lib::register_t::test<test_symbol_2_t>()
+};
@@ -0,0 +1,126 @@
+#include <array>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/thread.h"
+
+using namespace test_lib;
+
+namespace {
+// hammer a lock from several threads, a non atomic counter only adds
+// up if the lock excludes properly
+template <typename lock_t>
+bool exclusion(lock_t& lock)
+{
+    const int threads = 4;
+    const int count = 20000;
+    uint64_t value = 0;
+    std::vector<std::thread> thread;
+    for (int i = 0; i < threads; ++i) {
+        thread.emplace_back([&]() {
+            for (int j = 0; j < count; ++j) {
+                tengu::scope_lock_t<lock_t> guard(lock);
+                value += 1;
+            }
+        });
+    }
+    for (std::thread& t : thread) {
+        t.join();
+    }
+    return value == threads * count;
+}
+} // namespace {}
+
+// every lock type excludes other threads and try_lock fails while held
+struct test_thread_1_t: public test_t {
+
+    test_thread_1_t()
+        : test_t("test_thread_1_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        {
+            spinlock_t lock;
+            TEST_ASSERT(exclusion(lock));
+            TEST_ASSERT(lock.try_lock());
+            TEST_ASSERT(!lock.try_lock());
+            lock.unlock();
+        }
+        {
+            ticket_lock_t lock;
+            TEST_ASSERT(exclusion(lock));
+            TEST_ASSERT(lock.try_lock());
+            TEST_ASSERT(!lock.try_lock());
+            lock.unlock();
+        }
+        {
+            mcs_lock_t lock;
+            TEST_ASSERT(exclusion(lock));
+            mcs_lock_t::node_t a, b;
+            TEST_ASSERT(lock.try_lock(a));
+            TEST_ASSERT(!lock.try_lock(b));
+            lock.unlock(a);
+            // nested locks through the per thread nodes
+            mcs_lock_t other;
+            lock.lock();
+            other.lock();
+            other.unlock();
+            lock.unlock();
+        }
+        {
+            futex_lock_t lock;
+            TEST_ASSERT(exclusion(lock));
+            TEST_ASSERT(lock.try_lock());
+            TEST_ASSERT(!lock.try_lock());
+            lock.unlock();
+        }
+        return true;
+    }
+};
+
+// named locks report their statistics in instrumented builds
+struct test_thread_2_t: public test_t {
+
+    test_thread_2_t()
+        : test_t("test_thread_2_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        lock_stats_reset();
+        ticket_lock_t a("test.a");
+        futex_lock_t b("test.a");
+        for (int i = 0; i < 10; ++i) {
+            scope_lock_t<ticket_lock_t> guard(a);
+        }
+        for (int i = 0; i < 5; ++i) {
+            scope_lock_t<futex_lock_t> guard(b);
+        }
+        std::vector<lock_stats_t> stats;
+        lock_stats(stats);
+#if defined(TENGU_LOCK_STATS)
+        bool found = false;
+        for (const lock_stats_t& s : stats) {
+            if (strcmp(s.name_, "test.a") == 0) {
+                found = true;
+                TEST_ASSERT(s.acquires_ == 15);
+                TEST_ASSERT(s.contended_ == 0);
+                TEST_ASSERT(s.max_hold_ns_ <= s.hold_ns_);
+            }
+        }
+        TEST_ASSERT(found);
+#else
+        TEST_ASSERT(stats.empty());
+#endif
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 2> reg_test = {
+    test_lib::register_t::test<test_thread_1_t>(),
+    test_lib::register_t::test<test_thread_2_t>()
+};
@@ -9,6 +9,15 @@ uint64_t thing_ = 0;
 uint64_t get_time() {
     return thing_;
 }
+
+// clock which moves on a little every time it is read, so spin loops end
+uint64_t get_time_step() {
+    return thing_++;
+}
+
+void fake_sleep(uint64_t ticks) {
+    thing_ += ticks;
+}
 } // namespace {}
 
 struct test_timer_1_t: public test_t {
@@ -88,7 +97,92 @@ struct test_timer_2_t: public test_t {
     }
 };
 
-static std::array<test_lib::register_t*, 2> reg_test = {
+// tasks run at their own rates and catch up is bounded
+struct test_timer_3_t: public test_t {
+
+    test_timer_3_t()
+        : test_t("test_timer_3_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        thing_ = 0;
+        // millisecond clock
+        frame_scheduler_t<uint64_t> sched(get_time, 1000);
+        int physics = 0, ai = 0, anim = 0;
+        float physics_dt = 0.f, anim_dt = 0.f;
+        const uint32_t p = sched.add(120, [&](float dt) { ++physics; physics_dt = dt; });
+        const uint32_t a = sched.add(10, [&](float) { ++ai; });
+        const uint32_t d = sched.add(0, [&](float dt) { ++anim; anim_dt = dt; });
+        // one second of 16ms frames, 120 does not divide 1000
+        for (int i = 0; i < 62; ++i) {
+            thing_ += 16;
+            sched.tick();
+            TEST_ASSERT(sched.alpha(p) >= 0.f && sched.alpha(p) < 1.f);
+            TEST_ASSERT(sched.alpha(a) >= 0.f && sched.alpha(a) < 1.f);
+        }
+        thing_ += 8;
+        sched.tick();
+        TEST_ASSERT(sched.time() == 1.0);
+        TEST_ASSERT(physics == 120 && sched.steps(p) == 120);
+        TEST_ASSERT(ai == 10);
+        TEST_ASSERT(anim == 63 && sched.steps(d) == 63);
+        TEST_ASSERT(physics_dt == 1.f / 120.f);
+        TEST_ASSERT(anim_dt == 0.008f);
+        TEST_ASSERT(sched.alpha(p) == 0.f);
+        TEST_ASSERT(sched.alpha(d) == 1.f);
+        // a long stall only advances the virtual clock by max_delta_
+        thing_ += 5000;
+        sched.tick();
+        TEST_ASSERT(sched.time() == 1.25);
+        TEST_ASSERT(physics == 124);
+        TEST_ASSERT(sched.dropped(p) == 26);
+        TEST_ASSERT(ai == 12);
+        TEST_ASSERT(sched.dropped(a) == 0);
+        // and then carries on at the normal rate
+        thing_ += 25;
+        sched.tick();
+        TEST_ASSERT(physics == 127);
+        return true;
+    }
+};
+
+// wait() lands on each frame deadline and resyncs when far behind
+struct test_timer_4_t: public test_t {
+
+    test_timer_4_t()
+        : test_t("test_timer_4_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        thing_ = 0;
+        frame_scheduler_t<uint64_t> sched(get_time_step, 1000);
+        sched.sleep_ = fake_sleep;
+        sched.set_frame_rate(60);
+        const uint64_t base = thing_;
+        for (uint64_t i = 1; i <= 60; ++i) {
+            sched.wait();
+            // deadlines are exact on average even though 60 does not
+            // divide 1000
+            const uint64_t deadline = base + i * 1000 / 60;
+            TEST_ASSERT(thing_ >= deadline && thing_ <= deadline + 2);
+        }
+        // fall well behind, the next frame is paced from now
+        thing_ += 100;
+        sched.wait();
+        const uint64_t late = thing_;
+        sched.wait();
+        TEST_ASSERT(thing_ >= late + 16 && thing_ <= late + 19);
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 4> reg_test = {
     test_lib::register_t::test<test_timer_1_t>(),
-    test_lib::register_t::test<test_timer_2_t>()
+    test_lib::register_t::test<test_timer_2_t>(),
+    test_lib::register_t::test<test_timer_3_t>(),
+    test_lib::register_t::test<test_timer_4_t>()
 };
@@ -0,0 +1,242 @@
+#include <array>
+#include <functional>
+#include <vector>
+#include "../test_lib/test_lib.h"
+#include "../../framework_core/event.h"
+#include "../../framework_core/objects.h"
+#include "../../framework_core/wheel.h"
+
+using namespace test_lib;
+
+// timers fire on exactly their deadline across every level
+struct test_wheel_1_t: public test_t {
+
+    test_wheel_1_t()
+        : test_t("test_wheel_1_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        timer_wheel_t wheel;
+        std::vector<uint64_t> fired;
+        const uint64_t delay[] = { 1, 5, 255, 256, 257, 300, 65535, 65536,
+            70000, 1 << 24, (1 << 24) + 3 };
+        for (uint64_t d : delay) {
+            wheel.schedule(d, [&fired, &wheel]() {
+                fired.push_back(wheel.now());
+            });
+        }
+        TEST_ASSERT(wheel.size() == sizeof(delay) / sizeof(delay[0]));
+        // advance in uneven steps so cascades land mid step
+        while (wheel.size()) {
+            wheel.advance(97);
+        }
+        TEST_ASSERT(fired.size() == sizeof(delay) / sizeof(delay[0]));
+        for (size_t i = 0; i < fired.size(); ++i) {
+            TEST_ASSERT(fired[i] == delay[i]);
+        }
+        // the same again from a time which is not level aligned
+        fired.clear();
+        const uint64_t base = wheel.now();
+        for (uint64_t d : delay) {
+            wheel.schedule(d, [&fired, &wheel, base]() {
+                fired.push_back(wheel.now() - base);
+            });
+        }
+        while (wheel.size()) {
+            wheel.advance();
+        }
+        for (size_t i = 0; i < fired.size(); ++i) {
+            TEST_ASSERT(fired[i] == delay[i]);
+        }
+        return true;
+    }
+};
+
+// cancelling, stale handles, ordering and callbacks which reschedule
+struct test_wheel_2_t: public test_t {
+
+    test_wheel_2_t()
+        : test_t("test_wheel_2_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        timer_wheel_t wheel;
+        std::vector<int> order;
+        timer_handle_t a = wheel.schedule(10, [&order]() { order.push_back(1); });
+        timer_handle_t b = wheel.schedule(10, [&order]() { order.push_back(2); });
+        timer_handle_t c = wheel.schedule(10, [&order]() { order.push_back(3); });
+        TEST_ASSERT(wheel.pending(b) && wheel.remaining(b) == 10);
+        TEST_ASSERT(wheel.cancel(b));
+        TEST_ASSERT(!wheel.cancel(b) && !wheel.pending(b));
+        wheel.advance(10);
+        TEST_ASSERT(order.size() == 2 && order[0] == 1 && order[1] == 3);
+        TEST_ASSERT(!wheel.pending(a) && !wheel.cancel(c));
+        // a recycled node does not answer to an old handle
+        timer_handle_t d = wheel.schedule(1, []() {});
+        TEST_ASSERT(d != a && d != b && d != c && !wheel.cancel(b));
+        wheel.advance();
+        // a repeating timer and one cancelling another from its callback
+        int repeats = 0;
+        timer_handle_t victim;
+        std::function<void()> repeat = [&]() {
+            if (++repeats < 5) {
+                wheel.schedule(3, repeat);
+            }
+        };
+        wheel.schedule(3, repeat);
+        wheel.schedule(4, [&]() { wheel.cancel(victim); });
+        victim = wheel.schedule(5, [&order]() { order.push_back(99); });
+        wheel.advance(20);
+        TEST_ASSERT(repeats == 5 && order.size() == 2);
+        // big captures spill to the heap but behave the same
+        std::array<uint64_t, 32> big;
+        big.fill(7);
+        uint64_t sum = 0;
+        wheel.schedule(2, [big, &sum]() {
+            for (uint64_t v : big) {
+                sum += v;
+            }
+        });
+        wheel.schedule(300, [big]() {});
+        wheel.advance(2);
+        TEST_ASSERT(sum == 7 * 32 && wheel.size() == 1);
+        wheel.clear();
+        TEST_ASSERT(wheel.size() == 0);
+        return true;
+    }
+};
+
+namespace {
+enum {
+    e_type_sleeper = 0,
+};
+
+struct sleeper_t : public tengu::object_t {
+    sleeper_t(tengu::object_service_t)
+        : object_t(type())
+        , ticks_(0)
+    {
+    }
+
+    static tengu::object_type_t type() {
+        return e_type_sleeper;
+    }
+
+    static tengu::object_factory_t::creator_t* creator() {
+        return new tengu::object_create_t<sleeper_t>();
+    }
+
+    virtual void tick() override {
+        ++ticks_;
+    }
+
+    int ticks_;
+};
+
+struct delay_event_t : public tengu::event_t {
+    delay_event_t(int value)
+        : event_t(7)
+        , value_(value)
+    {
+    }
+
+    int value_;
+};
+
+struct delay_listener_t : public tengu::event_listener_t {
+    virtual void recieve_event(const tengu::event_t* e) override {
+        received_.push_back(static_cast<const delay_event_t*>(e)->value_);
+    }
+
+    std::vector<int> received_;
+};
+} // namespace {}
+
+// sleeping objects leave the tick loop until their timer fires
+struct test_wheel_3_t: public test_t {
+
+    test_wheel_3_t()
+        : test_t("test_wheel_3_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        for (int grouped = 0; grouped < 2; ++grouped) {
+            object_factory_t factory(nullptr);
+            factory.add_creator<sleeper_t>();
+            factory.set_grouped(grouped != 0);
+            object_ref_t a = factory.create<sleeper_t>();
+            object_ref_t b = factory.create<sleeper_t>();
+            factory.tick();
+            factory.tick();
+            sleeper_t& sa = a->cast<sleeper_t>();
+            sleeper_t& sb = b->cast<sleeper_t>();
+            TEST_ASSERT(sa.ticks_ == 1 && sb.ticks_ == 1);
+            factory.sleep(&sa, 5);
+            TEST_ASSERT(sa.is_sleeping());
+            for (int i = 0; i < 4; ++i) {
+                factory.tick();
+            }
+            TEST_ASSERT(sa.ticks_ == 1 && sb.ticks_ == 5);
+            // woken at the start of the fifth tick
+            factory.tick();
+            TEST_ASSERT(!sa.is_sleeping());
+            TEST_ASSERT(sa.ticks_ == 2 && sb.ticks_ == 6);
+            // woken early, and sleeping again replaces the old timer
+            factory.sleep(&sb, 100);
+            factory.sleep(&sb, 2);
+            TEST_ASSERT(factory.timers().size() == 1);
+            factory.wake(&sb);
+            TEST_ASSERT(factory.timers().size() == 0);
+            factory.tick();
+            TEST_ASSERT(sb.ticks_ == 7);
+            // collecting a sleeping object drops its wake up
+            factory.sleep(&sb, 10);
+            b->destroy();
+            b.dispose();
+            factory.collect();
+            TEST_ASSERT(factory.timers().size() == 0);
+        }
+        return true;
+    }
+};
+
+// events posted through a wheel arrive after their delay
+struct test_wheel_4_t: public test_t {
+
+    test_wheel_4_t()
+        : test_t("test_wheel_4_t")
+    {
+    }
+
+    virtual bool run() override {
+        using namespace tengu;
+        timer_wheel_t wheel;
+        event_stream_t stream;
+        delay_listener_t listener;
+        stream.add(&listener);
+        stream.post_after(wheel, 3, delay_event_t(3));
+        stream.post_after(wheel, 1, delay_event_t(1));
+        timer_handle_t h = stream.post_after(wheel, 2, delay_event_t(2));
+        wheel.cancel(h);
+        for (int i = 0; i < 4; ++i) {
+            wheel.advance();
+            stream.dispatch();
+        }
+        TEST_ASSERT(listener.received_.size() == 2);
+        TEST_ASSERT(listener.received_[0] == 1 && listener.received_[1] == 3);
+        return true;
+    }
+};
+
+static std::array<test_lib::register_t*, 4> reg_test = {
+    test_lib::register_t::test<test_wheel_1_t>(),
+    test_lib::register_t::test<test_wheel_2_t>(),
+    test_lib::register_t::test<test_wheel_3_t>(),
+    test_lib::register_t::test<test_wheel_4_t>()
+};